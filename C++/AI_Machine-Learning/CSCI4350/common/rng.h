@@ -0,0 +1,230 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: Shared by the CSCI 4350 projects
+ *    File: rng.h
+ *    File Description: Header file containing a small random number
+ *    generator based on xoshiro256** (Blackman and Vigna) to replace
+ *    the global rand(). Every generator owns its state, so each thread
+ *    can hold its own stream, and the jump functions split one seed
+ *    into non-overlapping streams so parallel runs stay reproducible.
+ *
+ */
+
+#ifndef XOSHIRO_RNG
+#define XOSHIRO_RNG
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+// xoshiro256: xoshiro256** generator. Satisfies the standard uniform
+// random bit generator requirements, so it can also drive the
+// distributions and algorithms of <random> and <algorithm>.
+class xoshiro256
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        typedef uint64_t result_type;
+
+        // xoshiro256 constructor: Expands a seed into the full state
+        // using splitmix64, as recommended by the authors.
+        explicit xoshiro256(uint64_t seed = 0)
+        {
+            Seed(seed);
+            return;
+        }
+
+        // Stream: Generator for the index-th stream of a seed. Streams are
+        // 2^128 draws apart, so threads given different indices never
+        // overlap and the same seed and index always give the same draws.
+        static xoshiro256 Stream(uint64_t seed, unsigned int index)
+        {
+            xoshiro256 generator(seed);
+            for(unsigned int i = 0; i < index; ++i)
+                generator.Jump();
+            return generator;
+        }
+
+        // Seed: Resets the state from a seed
+        void Seed(uint64_t seed)
+        {
+            for(int i = 0; i < 4; ++i)
+            {
+                seed += 0x9e3779b97f4a7c15ULL;
+                uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                state[i] = z ^ (z >> 31);
+            }
+            return;
+        }
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        // operator(): Next 64 random bits
+        result_type operator()()
+        {
+            const uint64_t result = Rotate(state[1] * 5, 7) * 9;
+            const uint64_t shifted = state[1] << 17;
+
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= shifted;
+            state[3] = Rotate(state[3], 45);
+
+            return result;
+        }
+
+        // Jump: Advances the state by 2^128 draws
+        void Jump()
+        {
+            static const uint64_t polynomial[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                                   0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+            Advance(polynomial);
+            return;
+        }
+
+        // LongJump: Advances the state by 2^192 draws, for splitting a
+        // stream between processes that will each Jump between threads
+        void LongJump()
+        {
+            static const uint64_t polynomial[] = { 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                                   0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+            Advance(polynomial);
+            return;
+        }
+
+        // Uniform: Uniform double on [0,1) built from the top 53 bits
+        double Uniform()
+        {
+            return ToUnit((*this)());
+        }
+
+        // Uniform: Uniform double on [low,high)
+        double Uniform(double low, double high)
+        {
+            return low + (high - low)*Uniform();
+        }
+
+        // Below: Uniform integer on [0,bound) by Lemire's multiply and shift,
+        // which avoids both the bias and the division of rand() % bound
+        uint32_t Below(uint32_t bound)
+        {
+            uint64_t product = uint64_t(uint32_t((*this)() >> 32)) * bound;
+            uint32_t low = uint32_t(product);
+            if(low < bound)
+            {
+                uint32_t threshold = uint32_t(-bound) % bound;
+                while(low < threshold)
+                {
+                    product = uint64_t(uint32_t((*this)() >> 32)) * bound;
+                    low = uint32_t(product);
+                }
+            }
+            return uint32_t(product >> 32);
+        }
+
+        // Normal: Standard normal double by the Box-Muller transform. The
+        // second variate of each pair is kept for the next call.
+        double Normal()
+        {
+            if(has_spare)
+            {
+                has_spare = false;
+                return spare;
+            }
+
+            double radius = sqrt(-2.0*log(1.0 - Uniform()));
+            double angle = 2.0*M_PI*Uniform();
+            spare = radius*sin(angle);
+            has_spare = true;
+            return radius*cos(angle);
+        }
+
+        // Uniform: Fills values with count uniform doubles on [low,high).
+        // The 53 bit integers are drawn first, which converts to double
+        // exactly, and scaled in a separate loop so the scaling vectorizes.
+        void Uniform(double values[], int count, double low, double high)
+        {
+            for(int i = 0; i < count; ++i)
+                values[i] = double((*this)() >> 11);
+
+            double scale = (high - low)*0x1.0p-53;
+            for(int i = 0; i < count; ++i)
+                values[i] = low + scale*values[i];
+            return;
+        }
+
+        // Normal: Fills values with count normal doubles of the given mean
+        // and standard deviation, transforming uniforms in pairs
+        void Normal(double values[], int count, double mean = 0.0, double deviation = 1.0)
+        {
+            int pairs = count/2;
+            Uniform(values, 2*pairs, 0.0, 1.0);
+
+            for(int i = 0; i < pairs; ++i)
+            {
+                double radius = deviation*sqrt(-2.0*log(1.0 - values[2*i]));
+                double angle = 2.0*M_PI*values[2*i + 1];
+                values[2*i] = mean + radius*cos(angle);
+                values[2*i + 1] = mean + radius*sin(angle);
+            }
+
+            if(count % 2 == 1)
+                values[count - 1] = mean + deviation*Normal();
+            return;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        uint64_t state[4];           // Generator state
+        double spare = 0.0;          // Unused second variate of the last Box-Muller pair
+        bool has_spare = false;      // Whether spare holds a variate
+
+        static uint64_t Rotate(uint64_t x, int k)
+        {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        static double ToUnit(uint64_t bits)
+        {
+            return (bits >> 11) * 0x1.0p-53;
+        }
+
+        // Advance: Applies a jump polynomial to the state
+        void Advance(const uint64_t polynomial[4])
+        {
+            uint64_t jumped[4] = { 0, 0, 0, 0 };
+            for(int i = 0; i < 4; ++i)
+            {
+                for(int b = 0; b < 64; ++b)
+                {
+                    if(polynomial[i] & (uint64_t(1) << b))
+                    {
+                        for(int k = 0; k < 4; ++k)
+                            jumped[k] ^= state[k];
+                    }
+                    (*this)();
+                }
+            }
+
+            for(int k = 0; k < 4; ++k)
+                state[k] = jumped[k];
+            has_spare = false;
+            return;
+        }
+
+};
+
+#endif
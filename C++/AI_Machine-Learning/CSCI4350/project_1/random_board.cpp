@@ -10,6 +10,8 @@
 #include <iostream>
 #include <cstdlib>
 
+#include "rng.h"
+
 using namespace std;
 
 // ShuffleBoard: Shuffles an input board randomly based on an initial
@@ -77,7 +79,7 @@ int main(int argc, char** argv)
 void ShuffleBoard(unsigned short board[][3], unsigned int moves, int seed, unsigned short zero_loc)
 {
 	// Use seed for random number generator
-	srand(seed);
+	xoshiro256 rng(seed);
 	
 	// Parse initial position of zero
 	unsigned short zrow = zero_loc%3;
@@ -87,7 +89,7 @@ void ShuffleBoard(unsigned short board[][3], unsigned int moves, int seed, unsig
 	for(int k = 0; k < moves; ++k)
 	{
 		// Select a random move out of four possible directions
-		int direction = rand()%4;
+		int direction = rng.Below(4);
 		
 		switch(direction)
 		{
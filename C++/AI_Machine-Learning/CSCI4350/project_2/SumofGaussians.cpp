@@ -4,62 +4,235 @@
 // Released to public domain
 
 #include "SumofGaussians.h"
+#include "rng.h"
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define LANDSCAPE_VERSION 1
+#define LANDSCAPE_HEADER 16  // Bytes before the centers, keeping them 8-byte aligned
 
 double getRandom() {
   return ((1.0*rand()) / (RAND_MAX + 1.0));
 }
 
+void SumofGaussians::clear() {
+  D=0;
+  N=0;
+  centers = NULL;
+  mapping = NULL;
+  mapping_bytes = 0;
+  single_centers = NULL;
+}
+
 SumofGaussians::SumofGaussians(int dimensions, int number_of_centers) {
-  if (dimensions < 1 || number_of_centers < 1) {
-    D=0;
-    N=0;
-    centers = NULL;
+  clear();
+  if (dimensions < 1 || number_of_centers < 1)
     return;
-  }
   
   D = dimensions;
   N = number_of_centers;
 
-  centers = new double*[N];
+  centers = new double[(long)N * D];
   
   for (int x = 0; x < N; x++) {
-    centers[x] = new double[D];
     for (int y = 0; y < D; y++)
-      centers[x][y] = (10.0 * rand()) / (RAND_MAX + 1.0);
+      centers[(long)x * D + y] = (10.0 * rand()) / (RAND_MAX + 1.0);
   }
 }
 
-SumofGaussians::~SumofGaussians() {
-  if (centers) {
-    for (int x = 0; x < N; x++)
-      delete [] centers[x];
+SumofGaussians::SumofGaussians(int dimensions, int number_of_centers, xoshiro256& rng) {
+  clear();
+  if (dimensions < 1 || number_of_centers < 1)
+    return;
+
+  D = dimensions;
+  N = number_of_centers;
+
+  centers = new double[(long)N * D];
+
+  // Drawing center by center keeps the landscapes of a seed unchanged
+  for (int x = 0; x < N; x++)
+    rng.Uniform(centers + (long)x * D, D, 0.0, 10.0);
+}
+
+SumofGaussians::SumofGaussians(const char *path, bool map) {
+  clear();
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return;
+
+  char magic[4];
+  uint32_t header[3];
+  bool valid = fread(magic, 1, 4, file) == 4 && memcmp(magic, "SOGL", 4) == 0 &&
+               fread(header, sizeof(uint32_t), 3, file) == 3 &&
+               header[0] == LANDSCAPE_VERSION && header[1] > 0 && header[2] > 0;
+
+  // The file must hold exactly the centers its header promises
+  long bytes = 0;
+  if (valid) {
+    fseek(file, 0, SEEK_END);
+    bytes = ftell(file);
+    valid = bytes == LANDSCAPE_HEADER + (long)header[1] * header[2] * (long)sizeof(double);
+  }
+  if (!valid) {
+    fclose(file);
+    return;
+  }
+
+#ifndef _WIN32
+  if (map) {
+    void *region = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fileno(file), 0);
+    if (region != MAP_FAILED) {
+      fclose(file);
+      mapping = region;
+      mapping_bytes = bytes;
+      D = header[1];
+      N = header[2];
+      centers = (double *)((char *)region + LANDSCAPE_HEADER);
+      return;
+    }
+  }
+#endif
+
+  // Without mapping (or where it is unavailable) the centers are copied
+  centers = new double[(long)header[1] * header[2]];
+  fseek(file, LANDSCAPE_HEADER, SEEK_SET);
+  size_t count = (size_t)header[1] * header[2];
+  if (fread(centers, sizeof(double), count, file) != count) {
     delete [] centers;
+    centers = NULL;
+    fclose(file);
+    return;
   }
+  fclose(file);
+  D = header[1];
+  N = header[2];
+}
+
+bool SumofGaussians::save(const char *path) const {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL)
+    return false;
+
+  uint32_t header[3] = { LANDSCAPE_VERSION, (uint32_t)D, (uint32_t)N };
+  size_t count = (size_t)N * D;
+  bool written = fwrite("SOGL", 1, 4, file) == 4 &&
+                 fwrite(header, sizeof(uint32_t), 3, file) == 3 &&
+                 fwrite(centers, sizeof(double), count, file) == count;
+  return (fclose(file) == 0) && written;
+}
+
+void SumofGaussians::make_single() const {
+  single_centers = new float[(long)N * D];
+  for (long i = 0; i < (long)N * D; i++)
+    single_centers[i] = (float)centers[i];
+}
+
+SumofGaussians::~SumofGaussians() {
+#ifndef _WIN32
+  if (mapping)
+    munmap(mapping, mapping_bytes);
+  else
+#endif
+    delete [] centers;
+  delete [] single_centers;
 }
 
-double SumofGaussians::eval(double point[]) const {
+double SumofGaussians::eval(const double point[]) const {
   double z = 0.0;
   for (int x = 0; x < N; x++) {
+    const double *c = centers + (long)x * D;
     double sum = 0.0;
     for (int y = 0; y < D; y++)
-      sum += (point[y]-centers[x][y]) * (point[y]-centers[x][y]);
+      sum += (point[y]-c[y]) * (point[y]-c[y]);
     z += exp(-sum);
   }
   return z;
 }
 
-void SumofGaussians::deriv(double point[], double d[]) const {
+// The loops are interchanged relative to eval so that each center is
+// read once per batch rather than once per point. Each value is still
+// summed over the centers in order, so the results match eval exactly.
+void SumofGaussians::eval_batch(const double points[], int count, double values[]) const {
+  for (int i = 0; i < count; i++)
+    values[i] = 0.0;
+  for (int x = 0; x < N; x++) {
+    const double *c = centers + (long)x * D;
+    for (int i = 0; i < count; i++) {
+      const double *point = points + (long)i * D;
+      double sum = 0.0;
+      for (int y = 0; y < D; y++)
+        sum += (point[y]-c[y]) * (point[y]-c[y]);
+      values[i] += exp(-sum);
+    }
+  }
+}
+
+// The points are transposed so that the innermost loop runs across the
+// batch, which the compiler vectorizes at twice the width of double.
+void SumofGaussians::eval_batch_float(const float points[], int count, float values[]) const {
+  std::call_once(single_made, &SumofGaussians::make_single, this);
+
+  std::vector<float> columns((long)count * D);
+  std::vector<float> sums(count);
+  for (int i = 0; i < count; i++)
+    for (int y = 0; y < D; y++)
+      columns[(long)y * count + i] = points[(long)i * D + y];
+
+  for (int i = 0; i < count; i++)
+    values[i] = 0.0f;
+  for (int x = 0; x < N; x++) {
+    const float *center = single_centers + (long)x * D;
+    for (int i = 0; i < count; i++)
+      sums[i] = 0.0f;
+    for (int y = 0; y < D; y++) {
+      const float *column = &columns[(long)y * count];
+      float c = center[y];
+      for (int i = 0; i < count; i++)
+        sums[i] += (column[i] - c) * (column[i] - c);
+    }
+    for (int i = 0; i < count; i++)
+      values[i] += expf(-sums[i]);
+  }
+}
+
+void SumofGaussians::deriv(const double point[], double d[]) const {
     for (int y = 0; y < D; y++)
       d[y] = 0.0;
     for (int x = 0; x < N; x++) {
+      const double *c = centers + (long)x * D;
       double sum = 0.0;
       for (int y = 0; y < D; y++)
-	sum += (point[y]-centers[x][y]) * (point[y]-centers[x][y]);
+	sum += (point[y]-c[y]) * (point[y]-c[y]);
       sum = exp(-sum);
       for (int y = 0; y < D; y++)
-	d[y] -= sum * (2.0 * (point[y] - centers[x][y]));
+	d[y] -= sum * (2.0 * (point[y] - c[y]));
     }
 }
+
+// Each Gaussian exp(-r^2) contributes exp(-r^2) * (4 r^2 - 2 D), so the
+// Laplacian costs one pass over the centers like eval.
+double SumofGaussians::laplacian(const double point[]) const {
+  double z = 0.0;
+  for (int x = 0; x < N; x++) {
+    const double *c = centers + (long)x * D;
+    double sum = 0.0;
+    for (int y = 0; y < D; y++)
+      sum += (point[y]-c[y]) * (point[y]-c[y]);
+    z += exp(-sum) * (4.0 * sum - 2.0 * D);
+  }
+  return z;
+}
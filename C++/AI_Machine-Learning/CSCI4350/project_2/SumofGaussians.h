@@ -6,8 +6,12 @@
 #ifndef SUMOFGAUSSIANS_H
 #define SUMOFGAUSSIANS_H
 
+#include <mutex>
+
 double getRandom();
 
+class xoshiro256;
+
 class SumofGaussians {
 public:
 
@@ -19,19 +23,75 @@ public:
   //                     search space
   SumofGaussians(int dimensions, int number_of_centers);
 
+  // Same as above, but the centers are drawn from the given generator
+  // instead of the global rand().
+  SumofGaussians(int dimensions, int number_of_centers, xoshiro256& rng);
+
+  // Load the centers written by save() from the given file. With
+  // map set the file is memory-mapped read-only rather than copied,
+  // so processes loading the same file share one copy of the centers.
+  // On failure the function is left empty (dimensions() == 0).
+  SumofGaussians(const char *path, bool map = true);
+
   // Standard
   ~SumofGaussians();
 
+  // Write the centers to the given file, returning false on failure.
+  // Format (host byte order): char[4] "SOGL", uint32 version,
+  // uint32 dimensions, uint32 centers, then the centers one after
+  // another as doubles.
+  bool save(const char *path) const;
+
+  // Whether the centers are memory-mapped from a file...
+  bool mapped() const { return mapping != NULL; }
+
   // Evaluate the function at the given point...
-  double eval(double point[]) const;
+  double eval(const double point[]) const;
   
+  // Evaluate the function at count points stored one after another in
+  // points, storing the results in values...
+  void eval_batch(const double points[], int count, double values[]) const;
+
+  // Same as eval_batch, but in single precision using a float copy of
+  // the centers. Roughly twice as fast, with relative errors around
+  // 1e-6, so it suits early, coarse phases of a search. Values below
+  // about 1e-38 underflow to zero...
+  void eval_batch_float(const float points[], int count, float values[]) const;
+
   // Evaluate the partial derivatives of the function at the given point...
-  void deriv(double point[], double d[]) const;
+  void deriv(const double point[], double d[]) const;
+
+  // Evaluate the Laplacian (sum of the unmixed second partial
+  // derivatives) of the function at the given point...
+  double laplacian(const double point[]) const;
+
+  // Number of dimensions, number of centers and the x-th center...
+  int dimensions() const { return D; }
+  int count() const { return N; }
+  const double *center(int x) const { return centers + (long)x * D; }
+
+  // The centers are owned by raw pointer (or mapping), so a copy would
+  // free them twice. Pass by reference instead.
+  SumofGaussians(const SumofGaussians&) = delete;
+  SumofGaussians& operator=(const SumofGaussians&) = delete;
 
 private:
   int D;
   int N;
-  double **centers;
+  double *centers;        // Centers stored one after another
+  void *mapping;          // Mapped file holding the centers, or NULL
+  long mapping_bytes;     // Length of the mapping
+
+  // Float copy of the centers, made on the first single precision
+  // batch so that mapped landscapes are not copied unless needed
+  mutable float *single_centers;
+  mutable std::once_flag single_made;
+
+  // Fill single_centers from centers...
+  void make_single() const;
+
+  // Start out empty...
+  void clear();
 };
 
 #endif
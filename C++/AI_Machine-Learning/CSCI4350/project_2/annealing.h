@@ -0,0 +1,174 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: annealing.h
+ *    File Description: Header file containing the simulated
+ *    annealing search used by sa.cpp, exposed one Metropolis step
+ *    at a time so that other programs can drive it.
+ *
+ */
+
+#ifndef SIMULATED_ANNEALING
+#define SIMULATED_ANNEALING
+
+#include <vector>
+#include <cmath>
+
+#include "SumofGaussians.h"
+#include "rng.h"
+
+#define SA_T_START      1.0    // Initial temperature scale
+#define SA_WINDOW       100    // Steps between temperature adjustments
+#define SA_ACCEPT_START 0.5    // Target acceptance rate at the start of the run
+#define SA_ACCEPT_END   0.01   // Target acceptance rate at the end of the run
+#define SA_COOLING      0.8    // Factor applied to the temperature per adjustment
+
+// simulated_annealing: A Metropolis chain whose temperature is scaled down
+// by the Laplacian ("coolness") of the function at the current point and
+// adapted every SA_WINDOW steps toward a falling target acceptance rate.
+class simulated_annealing
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // simulated_annealing constructor: Binds the chain to a function, a
+        // generator, the largest perturbation of a component and the
+        // number of steps in a run.
+        simulated_annealing(const SumofGaussians& function, int dimensions, xoshiro256& generator,
+                            double step_size, unsigned long steps)
+            : func(function), dims(dimensions), rng(generator), step(step_size), total_steps(steps),
+              point(dimensions), next_point(dimensions), best_point(dimensions)
+        {
+            taken = 0;
+            evaluations = 0;
+            return;
+        }
+
+        // Start: Begins a new run at the given preimage
+        void Start(const double preimage[])
+        {
+            for(int i = 0; i < dims; ++i)
+                point[i] = best_point[i] = preimage[i];
+
+            base_temperature = SA_T_START;
+            accepted = 0;
+            taken = 0;
+            evaluations = 1;
+            value = best_value = func.eval(point.data());
+            return;
+        }
+
+        // Step: Takes a single Metropolis step. Returns false without
+        // moving once the run has taken all of its steps.
+        bool Step()
+        {
+            if(Done())
+                return false;
+            ++taken;
+
+            // Compute the Laplacian of the sum at the current preimage
+            // to get a measurement of "coolness" and proximity to
+            // points which are relatively more "warm"
+            double coolness = func.laplacian(point.data());
+
+            // Compute temperature using coolness
+            double temperature = base_temperature/((coolness > 1.0) ? coolness : 1.0);
+
+            // Let next_point be point with each component preturbed by
+            // some random value in the interval [-step,step]
+            rng.Uniform(next_point.data(), dims, -step, step);
+            for(int j = 0; j < dims; ++j)
+                next_point[j] += point[j];
+
+            // Determine whether the next point should be used following
+            // the metropolis criterion
+            bool move = false;
+            double next_value = func.eval(next_point.data());
+            evaluations += 2;
+            if(next_value > value)
+                move = true;
+
+            else
+            {
+                // Compare values on a log scale, so the far tails of the
+                // Gaussians, where values differ by many orders of magnitude
+                // but very little absolutely, still pull the search uphill.
+                // Past the tails both values underflow to zero, and the
+                // search wanders freely until it finds a slope again.
+                if(value == 0.0 || rng.Uniform() < pow(next_value/value, 1.0/temperature))
+                    move = true;
+            }
+
+            if(move)
+            {
+                point.swap(next_point);
+                value = next_value;
+                ++accepted;
+
+                if(value > best_value)
+                {
+                    best_value = value;
+                    best_point = point;
+                }
+            }
+
+            // At the end of every window, cool if more moves were accepted than
+            // the target rate for this point of the run and heat if fewer. The
+            // target falls geometrically so the search settles into a peak.
+            if(taken % SA_WINDOW == 0)
+            {
+                double target = SA_ACCEPT_START*pow(SA_ACCEPT_END/SA_ACCEPT_START, double(taken)/total_steps);
+                if(double(accepted)/SA_WINDOW > target)
+                    base_temperature *= SA_COOLING;
+                else
+                    base_temperature /= SA_COOLING;
+
+                accepted = 0;
+            }
+
+            return true;
+        }
+
+        // Done: True once the run has taken all of its steps
+        bool Done() const
+        {
+            return taken >= total_steps;
+        }
+
+        // Accessors for the state and cost of the run. Each step costs an
+        // evaluation and a Laplacian, which is counted as one evaluation.
+        const double* Preimage() const        { return point.data(); }
+        double Value() const                  { return value; }
+        const double* BestPoint() const       { return best_point.data(); }
+        double BestValue() const              { return best_value; }
+        unsigned long Steps() const           { return taken; }
+        unsigned long Evaluations() const     { return evaluations; }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        const SumofGaussians& func;      // Function being maximized
+        int dims;                        // Number of dimensions of the search space
+        xoshiro256& rng;                 // Source of the proposals and acceptance draws
+        double step;                     // Largest perturbation of each component
+        unsigned long total_steps;       // Steps in a run
+
+        std::vector<double> point;       // Current state of the chain
+        std::vector<double> next_point;  // Proposed state
+        std::vector<double> best_point;  // Best state visited
+        double value;                    // Value of the current state
+        double best_value;               // Value of the best state
+        double base_temperature;         // Temperature scale adapted to the acceptance rate
+        unsigned int accepted;           // Moves accepted in the current window
+        unsigned long taken;             // Steps taken in the current run
+        unsigned long evaluations;       // Evaluations spent in the current run
+
+};
+
+#endif
@@ -0,0 +1,472 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: ascent_optimizers.h
+ *    File Description: Header file containing a common interface
+ *    for gradient ascent engines on a sum of Gaussians along with
+ *    fixed step, heavy-ball momentum, Nesterov, Adam and L-BFGS
+ *    implementations of that interface.
+ *
+ */
+
+#ifndef ASCENT_OPTIMIZERS
+#define ASCENT_OPTIMIZERS
+
+#include <vector>
+#include <string>
+#include <cmath>
+
+#include "SumofGaussians.h"
+
+// ascent_optimizer: Base class of all gradient ascent engines. A climb is
+// begun with Start and advanced one iteration at a time with Step until
+// Converged reports that the gradient norm fell below the tolerance. The
+// number of function and gradient evaluations spent is tracked so that
+// engines can be compared by cost rather than by iteration count.
+class ascent_optimizer
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // ascent_optimizer constructor: Binds the engine to a function and
+        // the gradient norm below which a climb is considered converged.
+        ascent_optimizer(const SumofGaussians& function, int dimensions, double tolerance)
+            : func(function), dims(dimensions), tol(tolerance), point(dimensions), grad(dimensions)
+        {
+            iterations = 0;
+            evaluations = 0;
+            gradient_evaluations = 0;
+            return;
+        }
+
+        virtual ~ascent_optimizer() {}
+
+        // Start: Begins a new climb at the given preimage, clearing any
+        // state and counters left over from a previous climb.
+        void Start(const double preimage[])
+        {
+            for(int i = 0; i < dims; ++i)
+                point[i] = preimage[i];
+
+            iterations = 0;
+            evaluations = 0;
+            gradient_evaluations = 0;
+
+            Reset();
+            Gradient(point.data(), grad.data());
+            return;
+        }
+
+        // Step: Takes a single iteration of the climb. Returns false without
+        // moving if the climb has already converged.
+        bool Step()
+        {
+            if(Converged())
+                return false;
+
+            Advance();
+            ++iterations;
+            return true;
+        }
+
+        // Converged: True once the gradient at the current point is flat
+        bool Converged() const
+        {
+            double norm = 0.0;
+            for(int i = 0; i < dims; ++i)
+                norm += grad[i]*grad[i];
+            return sqrt(norm) < tol;
+        }
+
+        // Accessors for the current state and cost of the climb
+        const double* Preimage() const                { return point.data(); }
+        const double* Gradient() const                { return grad.data(); }
+        unsigned long Iterations() const              { return iterations; }
+        unsigned long Evaluations() const             { return evaluations; }
+        unsigned long GradientEvaluations() const     { return gradient_evaluations; }
+
+        // Name: Name of the engine used when reporting results
+        virtual std::string Name() const = 0;
+
+    // ******************** PROTECTED CLASS CONTENTS ******************** \\
+
+    protected:
+
+        const SumofGaussians& func;  // Function being maximized
+        int dims;                    // Number of dimensions of the search space
+        double tol;                  // Gradient norm considered converged
+        std::vector<double> point;   // Current preimage of the climb
+        std::vector<double> grad;    // Gradient at the current preimage
+
+        // Reset: Clears engine specific state at the start of a climb
+        virtual void Reset() {}
+
+        // Advance: Moves point by one iteration and leaves grad holding
+        // the gradient at the new point.
+        virtual void Advance() = 0;
+
+        // Evaluate: Counted evaluation of the function
+        double Evaluate(double preimage[])
+        {
+            ++evaluations;
+            return func.eval(preimage);
+        }
+
+        // Gradient: Counted evaluation of the gradient
+        void Gradient(double preimage[], double d[])
+        {
+            ++gradient_evaluations;
+            func.deriv(preimage, d);
+            return;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        unsigned long iterations;            // Iterations taken in the current climb
+        unsigned long evaluations;           // Function evaluations in the current climb
+        unsigned long gradient_evaluations;  // Gradient evaluations in the current climb
+
+};
+
+// fixed_ascent: The original greedy climber, which steps along the
+// gradient scaled by a constant step size.
+class fixed_ascent : public ascent_optimizer
+{
+    public:
+
+        fixed_ascent(const SumofGaussians& function, int dimensions, double tolerance, double step_size)
+            : ascent_optimizer(function, dimensions, tolerance), step(step_size) {}
+
+        std::string Name() const { return "fixed"; }
+
+    protected:
+
+        double step;    // Constant scale applied to the gradient
+
+        void Advance()
+        {
+            for(int i = 0; i < dims; ++i)
+                point[i] = point[i] + step*grad[i];
+
+            Gradient(point.data(), grad.data());
+            return;
+        }
+};
+
+// momentum_ascent: Heavy-ball momentum, which accumulates a velocity from
+// past gradients so that long shallow slopes are crossed with
+// progressively larger steps.
+class momentum_ascent : public ascent_optimizer
+{
+    public:
+
+        momentum_ascent(const SumofGaussians& function, int dimensions, double tolerance, double step_size, double momentum = 0.9)
+            : ascent_optimizer(function, dimensions, tolerance), step(step_size), mu(momentum), velocity(dimensions) {}
+
+        std::string Name() const { return "momentum"; }
+
+    protected:
+
+        double step;                    // Scale applied to each new gradient
+        double mu;                      // Fraction of the velocity kept each iteration
+        std::vector<double> velocity;   // Accumulated velocity
+
+        void Reset()
+        {
+            velocity.assign(dims, 0.0);
+            return;
+        }
+
+        void Advance()
+        {
+            for(int i = 0; i < dims; ++i)
+            {
+                velocity[i] = mu*velocity[i] + step*grad[i];
+                point[i] = point[i] + velocity[i];
+            }
+
+            Gradient(point.data(), grad.data());
+            return;
+        }
+};
+
+// nesterov_ascent: Nesterov accelerated gradient. The stored point is the
+// look-ahead point, so only one gradient is needed per iteration and the
+// convergence test applies to the point actually reported.
+class nesterov_ascent : public ascent_optimizer
+{
+    public:
+
+        nesterov_ascent(const SumofGaussians& function, int dimensions, double tolerance, double step_size, double momentum = 0.9)
+            : ascent_optimizer(function, dimensions, tolerance), step(step_size), mu(momentum), velocity(dimensions) {}
+
+        std::string Name() const { return "nesterov"; }
+
+    protected:
+
+        double step;                    // Scale applied to each new gradient
+        double mu;                      // Fraction of the velocity kept each iteration
+        std::vector<double> velocity;   // Accumulated velocity
+
+        void Reset()
+        {
+            velocity.assign(dims, 0.0);
+            return;
+        }
+
+        void Advance()
+        {
+            for(int i = 0; i < dims; ++i)
+            {
+                double previous = velocity[i];
+                velocity[i] = mu*velocity[i] + step*grad[i];
+                point[i] = point[i] - mu*previous + (1.0 + mu)*velocity[i];
+            }
+
+            Gradient(point.data(), grad.data());
+            return;
+        }
+};
+
+// adam_ascent: Adam, which scales each component of the step by a running
+// estimate of the gradient's magnitude so that flat regions are crossed
+// at nearly the full step size.
+class adam_ascent : public ascent_optimizer
+{
+    public:
+
+        adam_ascent(const SumofGaussians& function, int dimensions, double tolerance, double step_size,
+                    double beta_1 = 0.9, double beta_2 = 0.999, double stability = 1e-12)
+            : ascent_optimizer(function, dimensions, tolerance), step(step_size), b1(beta_1), b2(beta_2), eps(stability),
+              first(dimensions), second(dimensions) {}
+
+        std::string Name() const { return "adam"; }
+
+    protected:
+
+        double step;                  // Largest distance moved in a component per iteration
+        double b1, b2;                // Decay rates of the first and second moments
+        double eps;                   // Guards against division by a zero second moment
+        double b1_power, b2_power;    // b1 and b2 raised to the iteration number
+        std::vector<double> first;    // Running mean of the gradient
+        std::vector<double> second;   // Running mean of the squared gradient
+
+        void Reset()
+        {
+            first.assign(dims, 0.0);
+            second.assign(dims, 0.0);
+            b1_power = 1.0;
+            b2_power = 1.0;
+            return;
+        }
+
+        void Advance()
+        {
+            b1_power *= b1;
+            b2_power *= b2;
+
+            for(int i = 0; i < dims; ++i)
+            {
+                first[i] = b1*first[i] + (1.0 - b1)*grad[i];
+                second[i] = b2*second[i] + (1.0 - b2)*grad[i]*grad[i];
+
+                // Correct the bias toward zero of the early moment estimates
+                double mean = first[i]/(1.0 - b1_power);
+                double variance = second[i]/(1.0 - b2_power);
+                point[i] = point[i] + step*mean/(sqrt(variance) + eps);
+            }
+
+            Gradient(point.data(), grad.data());
+            return;
+        }
+};
+
+// lbfgs_ascent: Limited memory BFGS with an Armijo backtracking line
+// search. The last few changes in point and gradient are used to build
+// an approximation of the inverse Hessian, giving nearly Newton steps near
+// a peak at the cost of a handful of extra function evaluations.
+class lbfgs_ascent : public ascent_optimizer
+{
+    public:
+
+        lbfgs_ascent(const SumofGaussians& function, int dimensions, double tolerance, double step_size,
+                     unsigned int history = 8, double sufficient_increase = 1e-4, unsigned int max_backtracks = 40)
+            : ascent_optimizer(function, dimensions, tolerance), step(step_size), memory(history),
+              armijo(sufficient_increase), backtracks(max_backtracks),
+              direction(dimensions), trial(dimensions), trial_grad(dimensions), alpha(history) {}
+
+        std::string Name() const { return "lbfgs"; }
+
+    protected:
+
+        double step;                    // Length of the first step, taken before any curvature is known
+        unsigned int memory;            // Number of curvature pairs kept
+        double armijo;                  // Fraction of the predicted increase that must be achieved
+        unsigned int backtracks;        // Halvings tried before the line search gives up
+        double value;                   // Function value at the current point
+        std::vector<double> direction;  // Search direction of the current iteration
+        std::vector<double> trial;      // Candidate point of the line search
+        std::vector<double> trial_grad; // Gradient at the accepted candidate
+        std::vector<double> alpha;      // Scratch coefficients of the two-loop recursion
+        std::vector<std::vector<double>> s_history;  // Changes in point, oldest first
+        std::vector<std::vector<double>> y_history;  // Changes in negated gradient, oldest first
+        std::vector<double> rho_history;             // Reciprocals of s.y for each pair
+
+        void Reset()
+        {
+            s_history.clear();
+            y_history.clear();
+            rho_history.clear();
+            value = Evaluate(point.data());
+            return;
+        }
+
+        void Advance()
+        {
+            ComputeDirection();
+
+            // The direction must point uphill, otherwise fall back to the gradient
+            double slope = Dot(grad, direction);
+            if(slope <= 0.0)
+            {
+                ClearHistory();
+                ComputeDirection();
+                slope = Dot(grad, direction);
+            }
+
+            // Backtrack until the Armijo sufficient increase condition holds
+            double t = 1.0;
+            double trial_value = value;
+            bool accepted = false;
+            for(unsigned int b = 0; b < backtracks && !accepted; ++b)
+            {
+                for(int i = 0; i < dims; ++i)
+                    trial[i] = point[i] + t*direction[i];
+
+                trial_value = Evaluate(trial.data());
+                if(trial_value >= value + armijo*t*slope)
+                    accepted = true;
+                else
+                    t *= 0.5;
+            }
+
+            // If no step gives an increase the point is as good as the
+            // precision allows, so report it as converged by zeroing grad
+            if(!accepted)
+            {
+                grad.assign(dims, 0.0);
+                return;
+            }
+
+            Gradient(trial.data(), trial_grad.data());
+
+            // Record the new curvature pair for the minimization of -f,
+            // skipping pairs that would break positive definiteness
+            std::vector<double> s(dims), y(dims);
+            for(int i = 0; i < dims; ++i)
+            {
+                s[i] = trial[i] - point[i];
+                y[i] = grad[i] - trial_grad[i];
+            }
+
+            double sy = Dot(s, y);
+            if(sy > 1e-12*sqrt(Dot(s, s)*Dot(y, y)))
+            {
+                if(s_history.size() == memory)
+                {
+                    s_history.erase(s_history.begin());
+                    y_history.erase(y_history.begin());
+                    rho_history.erase(rho_history.begin());
+                }
+
+                s_history.push_back(s);
+                y_history.push_back(y);
+                rho_history.push_back(1.0/sy);
+            }
+
+            point.swap(trial);
+            grad.swap(trial_grad);
+            value = trial_value;
+            return;
+        }
+
+    private:
+
+        // ComputeDirection: Two-loop recursion giving the quasi-Newton
+        // ascent direction from the stored curvature pairs
+        void ComputeDirection()
+        {
+            int pairs = s_history.size();
+
+            // Without curvature information, take a step of fixed length
+            if(pairs == 0)
+            {
+                double norm = sqrt(Dot(grad, grad));
+                for(int i = 0; i < dims; ++i)
+                    direction[i] = step*grad[i]/norm;
+                return;
+            }
+
+            direction = grad;
+            for(int k = pairs - 1; k >= 0; --k)
+            {
+                alpha[k] = rho_history[k]*Dot(s_history[k], direction);
+                for(int i = 0; i < dims; ++i)
+                    direction[i] -= alpha[k]*y_history[k][i];
+            }
+
+            // Scale by the most recent curvature estimate
+            double gamma = Dot(s_history[pairs-1], y_history[pairs-1])/Dot(y_history[pairs-1], y_history[pairs-1]);
+            for(int i = 0; i < dims; ++i)
+                direction[i] *= gamma;
+
+            for(int k = 0; k < pairs; ++k)
+            {
+                double beta = rho_history[k]*Dot(y_history[k], direction);
+                for(int i = 0; i < dims; ++i)
+                    direction[i] += (alpha[k] - beta)*s_history[k][i];
+            }
+
+            return;
+        }
+
+        // ClearHistory: Forgets all curvature pairs
+        void ClearHistory()
+        {
+            s_history.clear();
+            y_history.clear();
+            rho_history.clear();
+            return;
+        }
+
+        // Dot: Inner product of two vectors of length dims
+        double Dot(const std::vector<double>& a, const std::vector<double>& b) const
+        {
+            double total = 0.0;
+            for(int i = 0; i < dims; ++i)
+                total += a[i]*b[i];
+            return total;
+        }
+};
+
+// MakeOptimizer: Creates the engine with the given name, or returns
+// nullptr if no engine has that name. The caller owns the result.
+inline ascent_optimizer* MakeOptimizer(const std::string& name, const SumofGaussians& function, int dimensions,
+                                       double tolerance, double step_size)
+{
+    if(name == "fixed")       return new fixed_ascent(function, dimensions, tolerance, step_size);
+    if(name == "momentum")    return new momentum_ascent(function, dimensions, tolerance, step_size);
+    if(name == "nesterov")    return new nesterov_ascent(function, dimensions, tolerance, step_size);
+    if(name == "adam")        return new adam_ascent(function, dimensions, tolerance, step_size);
+    if(name == "lbfgs")       return new lbfgs_ascent(function, dimensions, tolerance, 10.0*step_size);
+    return nullptr;
+}
+
+#endif
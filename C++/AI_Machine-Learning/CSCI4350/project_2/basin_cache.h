@@ -0,0 +1,171 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: basin_cache.h
+ *    File Description: Header file containing a cache of the basins
+ *    of attraction found by hill climbs. Points visited by finished
+ *    climbs are hashed on a grid and mapped to the maximum their
+ *    climb reached, so a later climb entering one of those grid
+ *    cells can stop with the known answer.
+ *
+ */
+
+#ifndef BASIN_CACHE
+#define BASIN_CACHE
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+// basin_cache: Maps grid cells to the maxima reached from them, shared by
+// any number of threads. The cells are split between independently
+// locked shards so lookups from different threads rarely contend. Cells
+// are identified by a 64-bit hash of their coordinates alone, so two
+// cells colliding is possible but vanishingly unlikely.
+class basin_cache
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // basin_cache constructor: Cells are cubes with sides of cell_size.
+        // Smaller cells mislabel fewer points near the edge of a basin but
+        // are entered by fewer later climbs.
+        basin_cache(int dimensions, double cell_size, unsigned int shard_count = 64)
+            : dims(dimensions), cell(cell_size), shards(shard_count > 0 ? shard_count : 1)
+        {
+            hits = 0;
+            return;
+        }
+
+        // Cell: Hash of the grid cell holding the given point
+        uint64_t Cell(const double point[]) const
+        {
+            uint64_t hash = 0x9e3779b97f4a7c15ULL;
+            for(int i = 0; i < dims; ++i)
+            {
+                uint64_t coordinate = uint64_t(int64_t(floor(point[i]/cell)));
+                hash = Mix(hash ^ (coordinate + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2)));
+            }
+            return hash;
+        }
+
+        // Lookup: Basin of the given cell, or -1 if no finished climb
+        // has passed through it
+        int Lookup(uint64_t key)
+        {
+            shard& bucket = shards[key % shards.size()];
+            std::lock_guard<std::mutex> guard(bucket.lock);
+            auto found = bucket.cells.find(key);
+            if(found == bucket.cells.end())
+                return -1;
+
+            ++hits;
+            return found->second;
+        }
+
+        // AddMaximum: Returns the basin of the maximum at point, adding it
+        // unless a known maximum lies within a cell width of it
+        int AddMaximum(const double point[], double value)
+        {
+            std::lock_guard<std::mutex> guard(maxima_lock);
+            for(size_t m = 0; m < maxima.size(); ++m)
+            {
+                double distance = 0.0;
+                for(int i = 0; i < dims; ++i)
+                    distance += (point[i] - maxima[m][i])*(point[i] - maxima[m][i]);
+                if(distance < cell*cell)
+                    return int(m);
+            }
+
+            maxima.emplace_back(point, point + dims);
+            values.push_back(value);
+            return int(maxima.size() - 1);
+        }
+
+        // Record: Maps each of the given cells, visited by a climb that
+        // ended in the given basin, to that basin. Cells already mapped
+        // keep the basin of the climb that reached them first.
+        void Record(const std::vector<uint64_t>& path, int basin)
+        {
+            for(uint64_t key : path)
+            {
+                shard& bucket = shards[key % shards.size()];
+                std::lock_guard<std::mutex> guard(bucket.lock);
+                bucket.cells.emplace(key, basin);
+            }
+            return;
+        }
+
+        // Maximum: Copies the maximum of a basin into point and returns its value
+        double Maximum(int basin, double point[]) const
+        {
+            std::lock_guard<std::mutex> guard(maxima_lock);
+            for(int i = 0; i < dims; ++i)
+                point[i] = maxima[basin][i];
+            return values[basin];
+        }
+
+        // Basins: Number of distinct maxima found
+        size_t Basins() const
+        {
+            std::lock_guard<std::mutex> guard(maxima_lock);
+            return maxima.size();
+        }
+
+        // Cells: Number of cells mapped to a basin
+        size_t Cells() const
+        {
+            size_t total = 0;
+            for(const shard& bucket : shards)
+            {
+                std::lock_guard<std::mutex> guard(bucket.lock);
+                total += bucket.cells.size();
+            }
+            return total;
+        }
+
+        // Hits: Number of lookups that found a basin
+        unsigned long Hits() const
+        {
+            return hits;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        // shard: One independently locked part of the cell map
+        struct shard
+        {
+            mutable std::mutex lock;
+            std::unordered_map<uint64_t, int> cells;
+        };
+
+        int dims;                                   // Number of dimensions of the points
+        double cell;                                // Side of each grid cell
+        std::vector<shard> shards;                  // Cell map split by hash
+        mutable std::mutex maxima_lock;             // Guards maxima and values
+        std::vector<std::vector<double>> maxima;    // Maximum of each basin
+        std::vector<double> values;                 // Function value at each maximum
+        std::atomic<unsigned long> hits;            // Lookups that found a basin
+
+        // Mix: The splitmix64 finalizer, spreading the coordinates over
+        // every bit so that neighboring cells land in different shards
+        static uint64_t Mix(uint64_t x)
+        {
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        }
+
+};
+
+#endif
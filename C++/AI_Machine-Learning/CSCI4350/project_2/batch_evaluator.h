@@ -0,0 +1,215 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: batch_evaluator.h
+ *    File Description: Header file containing a class which evaluates
+ *    a sum of Gaussians at many points at once, splitting the points
+ *    between a set of worker threads that persist between batches.
+ *
+ */
+
+#ifndef BATCH_EVALUATOR
+#define BATCH_EVALUATOR
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include "SumofGaussians.h"
+
+// batch_evaluator: Evaluates batches of points in parallel. The workers
+// are started once and wait between batches, so the per-batch cost is a
+// wake-up rather than a thread creation. Batches may be evaluated in
+// single precision when a search only needs coarse values.
+class batch_evaluator
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // batch_evaluator constructor: Starts threads-1 workers, the calling
+        // thread being the last one. A thread count of 0 uses every core.
+        batch_evaluator(const SumofGaussians& function, int dimensions, unsigned int threads = 0)
+            : func(function), dims(dimensions)
+        {
+            if(threads == 0)
+                threads = std::thread::hardware_concurrency();
+            if(threads == 0)
+                threads = 1;
+
+            thread_count = threads;
+            batch = 0;
+            pending = 0;
+            stopping = false;
+            single = false;
+            evaluations = 0;
+
+            for(unsigned int t = 1; t < thread_count; ++t)
+                workers.emplace_back(&batch_evaluator::Work, this, t);
+            return;
+        }
+
+        // batch_evaluator destructor: Wakes and joins the workers
+        ~batch_evaluator()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            start.notify_all();
+
+            for(std::thread& worker : workers)
+                worker.join();
+            return;
+        }
+
+        // Evaluate: Stores in values the function at each of the count points
+        // laid out one after another in points
+        void Evaluate(const double points[], int count, double values[])
+        {
+            evaluations += count;
+
+            // Single precision batches are converted on the way in and out
+            if(single)
+            {
+                single_points.assign(points, points + long(count)*dims);
+                single_values.resize(count);
+            }
+
+            batch_points = points;
+            batch_values = values;
+            batch_count = count;
+
+            // Small batches are not worth waking the workers for
+            if(thread_count == 1 || count < int(2*thread_count))
+            {
+                EvaluateShare(0, 1);
+            }
+            else
+            {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    pending = thread_count - 1;
+                    ++batch;
+                }
+                start.notify_all();
+
+                EvaluateShare(0, thread_count);
+
+                std::unique_lock<std::mutex> waiting(lock);
+                done.wait(waiting, [this]{ return pending == 0; });
+            }
+
+            return;
+        }
+
+        // SetSinglePrecision: Chooses between single and double precision
+        // for the following batches
+        void SetSinglePrecision(bool use_single)
+        {
+            single = use_single;
+            return;
+        }
+
+        // SinglePrecision: Whether batches are evaluated in single precision
+        bool SinglePrecision() const
+        {
+            return single;
+        }
+
+        // Evaluations: Number of points evaluated so far
+        unsigned long Evaluations() const
+        {
+            return evaluations;
+        }
+
+        // Threads: Number of threads sharing each batch
+        unsigned int Threads() const
+        {
+            return thread_count;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        const SumofGaussians& func;          // Function being evaluated
+        int dims;                            // Length of each point
+        unsigned int thread_count;           // Workers plus the calling thread
+        std::vector<std::thread> workers;    // Worker threads
+
+        std::mutex lock;                     // Guards everything below
+        std::condition_variable start;       // Signals a new batch or shutdown
+        std::condition_variable done;        // Signals that the workers finished
+        unsigned long batch;                 // Number of the current batch
+        unsigned int pending;                // Workers still evaluating the batch
+        bool stopping;                       // Whether the workers should exit
+        const double* batch_points;          // Points of the current batch
+        double* batch_values;                // Values of the current batch
+        int batch_count;                     // Number of points in the current batch
+
+        bool single;                         // Whether batches use single precision
+        std::vector<float> single_points;    // Single precision copy of the batch
+        std::vector<float> single_values;    // Single precision values of the batch
+
+        unsigned long evaluations;           // Points evaluated so far
+
+        // EvaluateShare: Evaluates the contiguous share of the batch owned
+        // by the given thread when it is split between shares threads
+        void EvaluateShare(unsigned int id, unsigned int shares)
+        {
+            int first = int((long(batch_count)*id)/shares);
+            int last = int((long(batch_count)*(id + 1))/shares);
+            if(last <= first)
+                return;
+
+            // A point whose single precision value underflowed to zero lies
+            // past the tails of every Gaussian in float, and is evaluated again
+            // in double so its value still tells it apart from its neighbors
+            if(single)
+            {
+                func.eval_batch_float(single_points.data() + long(first)*dims, last - first, single_values.data() + first);
+                for(int i = first; i < last; ++i)
+                    batch_values[i] = (single_values[i] != 0.0f) ? single_values[i] : func.eval(batch_points + long(i)*dims);
+            }
+            else
+                func.eval_batch(batch_points + long(first)*dims, last - first, batch_values + first);
+            return;
+        }
+
+        // Work: Body of each worker, which evaluates its share of every
+        // batch until the evaluator is destroyed
+        void Work(unsigned int id)
+        {
+            unsigned long seen = 0;
+            while(true)
+            {
+                {
+                    std::unique_lock<std::mutex> waiting(lock);
+                    start.wait(waiting, [&]{ return stopping || batch != seen; });
+                    if(stopping)
+                        return;
+                    seen = batch;
+                }
+
+                EvaluateShare(id, thread_count);
+
+                bool last;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    last = (--pending == 0);
+                }
+                if(last)
+                    done.notify_one();
+            }
+        }
+
+};
+
+#endif
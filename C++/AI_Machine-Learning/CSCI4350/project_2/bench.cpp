@@ -0,0 +1,386 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: bench.cpp
+ *    File Description: This file benchmarks every local
+ *    search in the project on a fixed, seeded suite of sums of
+ *    Gaussians. Each search is restarted from random points
+ *    until an evaluation budget or a wall-clock budget is spent,
+ *    and the results are written to standard output as CSV.
+ *
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#define DEFAULT_EVALUATIONS 20000  // Evaluation budget of each run
+#define DEFAULT_SECONDS     0.1    // Wall-clock budget of each run
+#define EPSILON             1e-6   // Gradient norm at which a climb has converged
+#define STEP_SIZE           0.01   // Step size of the gradient ascent engines
+#define SA_STEP_SIZE        0.1    // Perturbation size of simulated annealing
+#define SA_STEPS            7500   // Steps in each annealing run
+#define MAX_ITERATIONS      100000 // Climbs that have not converged by now are restarted
+#define TARGET_GAP          1e-4   // Relative gap to the best-known maximum counted as reaching it
+
+#include "SumofGaussians.h"
+#include "rng.h"
+#include "ascent_optimizers.h"
+#include "annealing.h"
+#include "batch_evaluator.h"
+#include "population_optimizers.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Landscapes of the suite, from small and easy to large and rugged
+struct LandscapeSpec
+{
+    int dimensions;
+    int centers;
+};
+
+const LandscapeSpec SUITE[] = { {2, 10}, {2, 100}, {5, 50}, {5, 500},
+                                {10, 100}, {10, 1000}, {20, 200}, {20, 1000} };
+
+// Searches run on every landscape
+const char* METHODS[] = { "fixed", "momentum", "nesterov", "adam", "lbfgs", "sa",
+                          "cmaes", "cmaes-mixed", "de", "de-mixed" };
+
+// search_runner: Gives every search the same restartable step interface.
+// Restart begins a new run from a random point, Step advances it and
+// returns false once the run is finished.
+class search_runner
+{
+    public:
+
+        virtual ~search_runner() {}
+        virtual void Restart() = 0;
+        virtual bool Step() = 0;
+
+        // Finish: Accounts for a run cut off by the budget
+        virtual void Finish() {}
+
+        // Best value over all runs and evaluations spent by all runs
+        virtual double BestValue() const = 0;
+        virtual unsigned long Evaluations() const = 0;
+};
+
+// ascent_runner: Multi-start gradient ascent with one of the engines
+class ascent_runner : public search_runner
+{
+    public:
+
+        ascent_runner(ascent_optimizer* engine, const SumofGaussians& function, int dimensions, xoshiro256& generator)
+            : climber(engine), func(function), start(dimensions), rng(generator)
+        {
+            best = -1.0;
+            finished_evaluations = 0;
+            return;
+        }
+
+        ~ascent_runner() { delete climber; }
+
+        void Restart()
+        {
+            rng.Uniform(start.data(), start.size(), 0.0, 10.0);
+            climber->Start(start.data());
+            return;
+        }
+
+        bool Step()
+        {
+            if(!climber->Converged() && climber->Iterations() < MAX_ITERATIONS)
+                return climber->Step();
+
+            // The climb is over, so its end point is evaluated once
+            finished_evaluations += Cost() + 1;
+            best = max(best, func.eval(climber->Preimage()));
+            return false;
+        }
+
+        // A climb cut off by the budget still counts the point it reached
+        void Finish()
+        {
+            finished_evaluations += 1;
+            best = max(best, func.eval(climber->Preimage()));
+            return;
+        }
+
+        double BestValue() const { return best; }
+        unsigned long Evaluations() const { return finished_evaluations + Cost(); }
+
+    private:
+
+        ascent_optimizer* climber;
+        const SumofGaussians& func;
+        vector<double> start;
+        xoshiro256& rng;
+        double best;
+        unsigned long finished_evaluations;
+
+        // Cost: Evaluations and gradients spent by the current climb
+        unsigned long Cost() const { return climber->Evaluations() + climber->GradientEvaluations(); }
+};
+
+// annealing_runner: Repeated simulated annealing runs
+class annealing_runner : public search_runner
+{
+    public:
+
+        annealing_runner(const SumofGaussians& function, int dimensions, xoshiro256& generator)
+            : annealer(function, dimensions, generator, SA_STEP_SIZE, SA_STEPS), start(dimensions), rng(generator)
+        {
+            best = -1.0;
+            finished_evaluations = 0;
+            running = false;
+            return;
+        }
+
+        void Restart()
+        {
+            if(running)
+                finished_evaluations += annealer.Evaluations();
+
+            rng.Uniform(start.data(), start.size(), 0.0, 10.0);
+            annealer.Start(start.data());
+            running = true;
+            return;
+        }
+
+        bool Step()
+        {
+            bool moved = annealer.Step();
+            best = max(best, annealer.BestValue());
+            return moved;
+        }
+
+        double BestValue() const { return best; }
+        unsigned long Evaluations() const { return finished_evaluations + (running ? annealer.Evaluations() : 0); }
+
+    private:
+
+        simulated_annealing annealer;
+        vector<double> start;
+        xoshiro256& rng;
+        double best;
+        unsigned long finished_evaluations;
+        bool running;
+};
+
+// population_runner: Repeated CMA-ES or differential evolution searches,
+// each step being one generation
+class population_runner : public search_runner
+{
+    public:
+
+        population_runner(population_optimizer* engine) : search(engine)
+        {
+            best = -1.0;
+            finished_evaluations = 0;
+            running = false;
+            return;
+        }
+
+        ~population_runner() { delete search; }
+
+        void Restart()
+        {
+            if(running)
+                finished_evaluations += search->Evaluations();
+
+            search->Start();
+            best = max(best, search->BestValue());
+            running = true;
+            return;
+        }
+
+        bool Step()
+        {
+            bool moved = search->Step();
+            best = max(best, search->BestValue());
+            return moved;
+        }
+
+        double BestValue() const { return best; }
+        unsigned long Evaluations() const { return finished_evaluations + (running ? search->Evaluations() : 0); }
+
+    private:
+
+        population_optimizer* search;
+        double best;
+        unsigned long finished_evaluations;
+        bool running;
+};
+
+// RunResult: One row of the output
+struct RunResult
+{
+    string method;
+    string budget;
+    double best_value;
+    unsigned long evaluations;
+    double seconds;
+    long evaluations_to_target;     // -1 if the target was never reached
+    double seconds_to_target;       // -1 if the target was never reached
+};
+
+// MakeRunner: Creates the runner of the named search. The caller owns the result.
+search_runner* MakeRunner(const string& method, const SumofGaussians& sum_func, int dimens,
+                          batch_evaluator& evaluator, xoshiro256& rng);
+
+// ReferenceMaximum: Best-known maximum of a landscape, found by climbing
+// with L-BFGS from every center, since each peak lies near a center
+double ReferenceMaximum(const SumofGaussians& sum_func, int dimens);
+
+// RunBudget: Restarts a search until either budget is spent
+RunResult RunBudget(search_runner& runner, unsigned long max_evaluations, double max_seconds, double target);
+
+// Mainline logic
+int main(int argc, char** argv)
+{
+    // Check command line arguments for errors
+    if (argc > 4)
+    {
+        cout << "Usage: ./bench [random number seed] [evaluation budget] [seconds budget]" << endl;
+        return 1;
+    }
+
+    ios_base::sync_with_stdio(false);
+
+    // Read command line arguments into variables
+    int seed = (argc > 1) ? atoi(argv[1]) : 1;
+    unsigned long max_evaluations = (argc > 2) ? strtoul(argv[2], nullptr, 10) : DEFAULT_EVALUATIONS;
+    double max_seconds = (argc > 3) ? atof(argv[3]) : DEFAULT_SECONDS;
+
+    cout << "seed,dimensions,centers,method,budget,evaluations,seconds,best_value,best_known,gap,"
+         << "evaluations_per_second,evaluations_to_target,seconds_to_target" << '\n';
+
+    int landscapes = sizeof(SUITE)/sizeof(SUITE[0]);
+    int methods = sizeof(METHODS)/sizeof(METHODS[0]);
+    for(int l = 0; l < landscapes; ++l)
+    {
+        int dimens = SUITE[l].dimensions;
+
+        // Each landscape has its own seed so the suite does not depend
+        // on which landscapes are run
+        xoshiro256 landscape_rng(seed + l);
+        SumofGaussians sum_func(dimens, SUITE[l].centers, landscape_rng);
+        batch_evaluator evaluator(sum_func, dimens);
+
+        double reference = ReferenceMaximum(sum_func, dimens);
+        double target = reference - TARGET_GAP*max(1.0, fabs(reference));
+
+        // Run every search under each budget, each from its own stream
+        vector<RunResult> results;
+        for(int m = 0; m < methods; ++m)
+        {
+            for(int b = 0; b < 2; ++b)
+            {
+                xoshiro256 rng = xoshiro256::Stream(seed + l, 1 + m);
+                search_runner* runner = MakeRunner(METHODS[m], sum_func, dimens, evaluator, rng);
+
+                RunResult result = (b == 0) ? RunBudget(*runner, max_evaluations, INFINITY, target)
+                                            : RunBudget(*runner, ~0UL, max_seconds, target);
+                result.method = METHODS[m];
+                result.budget = (b == 0) ? "evaluations" : "seconds";
+                results.push_back(result);
+
+                delete runner;
+            }
+        }
+
+        // Any search may beat the reference, so the best known is taken last
+        double best_known = reference;
+        for(const RunResult& result : results)
+            best_known = max(best_known, result.best_value);
+
+        for(const RunResult& result : results)
+        {
+            cout << seed + l << "," << dimens << "," << SUITE[l].centers << ","
+                 << result.method << "," << result.budget << ","
+                 << result.evaluations << "," << result.seconds << ","
+                 << result.best_value << "," << best_known << "," << best_known - result.best_value << ","
+                 << result.evaluations/max(result.seconds, 1e-9) << ",";
+            if(result.evaluations_to_target >= 0)
+                cout << result.evaluations_to_target << "," << result.seconds_to_target << '\n';
+            else
+                cout << "NA,NA" << '\n';
+        }
+        cout.flush();
+    }
+
+    return 0;
+}
+
+// MakeRunner: Creates the runner of the named search. The caller owns the result.
+search_runner* MakeRunner(const string& method, const SumofGaussians& sum_func, int dimens,
+                          batch_evaluator& evaluator, xoshiro256& rng)
+{
+    if(method == "sa")
+        return new annealing_runner(sum_func, dimens, rng);
+
+    ascent_optimizer* climber = MakeOptimizer(method, sum_func, dimens, EPSILON, STEP_SIZE);
+    if(climber != nullptr)
+        return new ascent_runner(climber, sum_func, dimens, rng);
+
+    return new population_runner(MakePopulationOptimizer(method, evaluator, dimens, rng));
+}
+
+// ReferenceMaximum: Best-known maximum of a landscape, found by climbing
+// with L-BFGS from every center, since each peak lies near a center
+double ReferenceMaximum(const SumofGaussians& sum_func, int dimens)
+{
+    lbfgs_ascent climber(sum_func, dimens, EPSILON, 10.0*STEP_SIZE);
+    double best = -1.0;
+
+    for(int x = 0; x < sum_func.count(); ++x)
+    {
+        climber.Start(sum_func.center(x));
+        while(climber.Step() && climber.Iterations() < MAX_ITERATIONS)
+            ;
+        best = max(best, sum_func.eval(climber.Preimage()));
+    }
+
+    return best;
+}
+
+// RunBudget: Restarts a search until either budget is spent
+RunResult RunBudget(search_runner& runner, unsigned long max_evaluations, double max_seconds, double target)
+{
+    RunResult result;
+    result.evaluations_to_target = -1;
+    result.seconds_to_target = -1.0;
+
+    steady_clock::time_point begin = steady_clock::now();
+    double elapsed = 0.0;
+
+    runner.Restart();
+    while(runner.Evaluations() < max_evaluations && elapsed < max_seconds)
+    {
+        if(!runner.Step())
+            runner.Restart();
+
+        elapsed = duration<double>(steady_clock::now() - begin).count();
+
+        // Record the first time the search comes within the target gap
+        if(result.evaluations_to_target < 0 && runner.BestValue() >= target)
+        {
+            result.evaluations_to_target = runner.Evaluations();
+            result.seconds_to_target = elapsed;
+        }
+    }
+
+    runner.Finish();
+    result.best_value = runner.BestValue();
+    result.evaluations = runner.Evaluations();
+    result.seconds = elapsed;
+    return result;
+}
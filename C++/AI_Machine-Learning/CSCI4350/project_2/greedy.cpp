@@ -15,109 +15,135 @@
 
 #include <iostream>
 #include <cstdlib>
-#include <cmath>
+#include <string>
 
 #define EPSILON 0.00000001    // Error tolerance for convergence
 #define STEP_SIZE 0.01        // Step size of greedy hill climb
+#define MAX_ITERATIONS 10000000  // Iteration limit for engines that may not settle
 
 #include "SumofGaussians.h"
+#include "rng.h"
+#include "trace.h"
+#include "ascent_optimizers.h"
 
 using namespace std;
 
-// VectorNorm: Takes the Euclidean norm of a vector
-// with a specified number of dimensions
-double VectorNorm(double vector[], int dimensions);
-
-// ScaleVector: Scales a vector by a constant value
-void ScaleVector(double vector[], int dimensions, double scalar);
-
 // Mainline logic
 int main(int argc, char** argv)
 {
     // Variables for storing the number of summands and dimensions
     int dimens, summands;
 
+    // Separate the option flags from the positional arguments
+    search_options options;
+    argc = ParseSearchOptions(argc, argv, options);
+
     // Check command line arguments for errors
-    if (argc != 4)
+    if (argc != 4 && argc != 5)
     {
-        cout << "Usage: ./greedy <random number seed> <dimensions> <number of random variables>" << endl;
+        cout << "Usage: ./greedy <random number seed> <dimensions> <number of random variables> [fixed|momentum|nesterov|adam|lbfgs] [-q | -e <k>] [-t <trace file>] [-l <landscape file>]" << endl;
         return 1;
     }
 
+    // The trajectory is written with '\n' rather than endl, so let cout
+    // buffer freely instead of synchronizing with stdio
+    ios_base::sync_with_stdio(false);
+
     // Read command line arguments into variables
     dimens = atoi(argv[2]);
     summands = atoi(argv[3]);
 
-    // Seed random number generator with command line argument
-    srand(atoi(argv[1]));
+    // Seed the landscape and the search with separate streams of the
+    // command line argument, so the search starts from the same points
+    // whether the landscape is generated or loaded from a file
+    xoshiro256 landscape_rng(atoi(argv[1]));
+    xoshiro256 rng = xoshiro256::Stream(atoi(argv[1]), 1);
+
+    // Compute a sum of Gaussians, or load a saved one whose size must
+    // match the one given so the arguments still describe the search
+    SumofGaussians* landscape = options.landscape_path.empty()
+                                ? new SumofGaussians(dimens, summands, landscape_rng)
+                                : new SumofGaussians(options.landscape_path.c_str());
+    if (!options.landscape_path.empty() && (landscape->dimensions() != dimens || landscape->count() != summands))
+    {
+        cout << "Unable to load a landscape of " << summands << " centers in " << dimens
+             << " dimensions from: " << options.landscape_path << endl;
+        delete landscape;
+        return 1;
+    }
+    SumofGaussians& sum_func = *landscape;
 
-    // Compute a sum of Gaussians
-    SumofGaussians sum_func(dimens, summands);
+    // Variable to store preimage
+    double preimage[dimens];
 
-    // Variables to store preimage and gradient of preimage
-    double preimage[dimens], grad[dimens];
+    // Generate random initial point with components on interval [0,10]
+    rng.Uniform(preimage, dimens, 0.0, 10.0);
 
-    // Generate random initial point
-    for(int i = 0; i < dimens; ++i)
+    // Choose the ascent engine, defaulting to the fixed step climber. The
+    // original test |STEP_SIZE*grad| < EPSILON is kept as |grad| < EPSILON/STEP_SIZE
+    string method = (argc == 5) ? argv[4] : "fixed";
+    ascent_optimizer* climber = MakeOptimizer(method, sum_func, dimens, EPSILON/STEP_SIZE, STEP_SIZE);
+    if (climber == nullptr)
     {
-        // Generate random components on interval [0,10]
-        preimage[i] = ((1.0*rand())/RAND_MAX)*10.0;
+        cout << "Unknown optimizer: " << method << endl;
+        delete landscape;
+        return 1;
     }
 
-    // Find an initial gradient
-    sum_func.deriv(preimage, grad);
-
-    // Scale gradient to appropriate step size
-    ScaleVector(grad,dimens,STEP_SIZE);
+    trace_writer trace;
+    if (!options.trace_path.empty() && !trace.Open(options.trace_path, dimens))
+    {
+        cout << "Unable to open trace file: " << options.trace_path << endl;
+        delete climber;
+        delete landscape;
+        return 1;
+    }
 
     // Perform greedy local search on sum of Gaussians
-    while( VectorNorm(grad, dimens) >= EPSILON )
+    climber->Start(preimage);
+    while( !climber->Converged() && climber->Iterations() < MAX_ITERATIONS )
     {
-        // Print current preimage and function value
-        for(int j = 0; j < dimens; ++j)
-            cout << preimage[j] << " ";
-        cout << " " << sum_func.eval(preimage) << endl;
-
-        // Recompute preimage by following gradient
-        for(int k = 0; k < dimens; ++k)
+        // The value is only needed when it is reported
+        bool print = ShouldPrint(options, climber->Iterations());
+        if (print || trace.IsOpen())
         {
-            preimage[k] = preimage[k] + grad[k];
+            double value = sum_func.eval(climber->Preimage());
+
+            // Print current preimage and function value
+            if (print)
+            {
+                for(int j = 0; j < dimens; ++j)
+                    cout << climber->Preimage()[j] << " ";
+                cout << " " << value << '\n';
+            }
+
+            if (trace.IsOpen())
+                trace.Record(climber->Iterations(), value, climber->Preimage());
         }
 
-        // Recompute gradient given change in preimage
-        sum_func.deriv(preimage, grad);
-        ScaleVector(grad,dimens,STEP_SIZE);
+        climber->Step();
     }
 
     // Print terminal values
     for(int j = 0; j < dimens; ++j)
+    {
+        preimage[j] = climber->Preimage()[j];
         cout << preimage[j] << " ";
-    cout << " " << sum_func.eval(preimage) << endl;
-
-    return 0;
+    }
+    double final_value = sum_func.eval(preimage);
+    cout << " " << final_value << endl;
 
-}
+    if (trace.IsOpen())
+        trace.Record(climber->Iterations(), final_value, preimage);
 
-// VectorNorm: Takes the Euclidean norm of a vector
-// with a specified number of dimensions
-double VectorNorm(double vector[], int dimensions)
-{
-    // Initialiaze norm to 0
-    double norm = 0.0;
+    // Report the cost of the climb separately from the trajectory
+    cerr << climber->Name() << ": " << climber->Iterations() << " iterations, "
+         << climber->Evaluations() << " evaluations, "
+         << climber->GradientEvaluations() << " gradient evaluations" << endl;
 
-    // Take sum of squares of components
-    for(int i = 0; i < dimensions; ++i)
-    {
-        norm += vector[i]*vector[i];
-    }
+    delete climber;
+    delete landscape;
 
-    // Return square room of sum of squares
-    return sqrt(norm);
-}
+    return 0;
 
-// ScaleVector: Scales a vector by a constant value
-void ScaleVector(double vector[], int dimensions, double scalar)
-{
-    for(int i = 0; i < dimensions; ++i)
-        vector[i] = vector[i]*scalar;
 }
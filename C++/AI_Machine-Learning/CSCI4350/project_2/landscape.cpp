@@ -0,0 +1,66 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: landscape.cpp
+ *    File Description: This file generates a sum of Gaussian
+ *    random variables from a seed and saves its centers to a
+ *    binary file, which greedy, sa and population can then
+ *    search with -l instead of regenerating the landscape.
+ *
+ */
+
+#include <iostream>
+#include <cstdlib>
+
+#include "SumofGaussians.h"
+#include "rng.h"
+
+using namespace std;
+
+// Mainline logic
+int main(int argc, char** argv)
+{
+    // Check command line arguments for errors
+    if (argc != 5)
+    {
+        cout << "Usage: ./landscape <random number seed> <dimensions> <number of random variables> <landscape file>" << endl;
+        return 1;
+    }
+
+    // Read command line arguments into variables
+    int dimens = atoi(argv[2]);
+    int summands = atoi(argv[3]);
+
+    // Generate the landscape exactly as the search programs do
+    xoshiro256 rng(atoi(argv[1]));
+    SumofGaussians sum_func(dimens, summands, rng);
+    if (sum_func.dimensions() == 0)
+    {
+        cout << "The landscape needs at least one dimension and one center" << endl;
+        return 1;
+    }
+
+    if (!sum_func.save(argv[4]))
+    {
+        cout << "Unable to write landscape file: " << argv[4] << endl;
+        return 1;
+    }
+
+    // Check the file by mapping it back and comparing every center
+    SumofGaussians saved(argv[4]);
+    bool matches = saved.dimensions() == dimens && saved.count() == summands;
+    for (int x = 0; matches && x < summands; ++x)
+        for (int y = 0; y < dimens; ++y)
+            matches = matches && saved.center(x)[y] == sum_func.center(x)[y];
+
+    if (!matches)
+    {
+        cout << "Landscape file does not match: " << argv[4] << endl;
+        return 1;
+    }
+
+    return 0;
+}
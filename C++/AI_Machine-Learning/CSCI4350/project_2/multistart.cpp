@@ -0,0 +1,237 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: multistart.cpp
+ *    File Description: This file runs the greedy hill climb
+ *    from many random points on a sum of Gaussian random
+ *    variables across several threads, sharing a cache of
+ *    known basins so that a climb entering a basin already
+ *    climbed stops with the known maximum.
+ *
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#define EPSILON        0.00000001  // Error tolerance for convergence
+#define STEP_SIZE      0.01        // Step size of greedy hill climb
+#define MAX_ITERATIONS 10000000    // Iteration limit for engines that may not settle
+#define DEFAULT_STARTS 64          // Climbs run when no count is given
+#define CELL_SIZE      0.2         // Side of the grid cells of the basin cache
+
+#include "SumofGaussians.h"
+#include "rng.h"
+#include "trace.h"
+#include "ascent_optimizers.h"
+#include "basin_cache.h"
+
+using namespace std;
+
+// ClimbResult: Outcome of the climb from one start
+struct ClimbResult
+{
+    vector<double> preimage;      // Maximum reached
+    double value;                 // Function value at the maximum
+    unsigned long iterations;     // Iterations climbed before stopping
+    unsigned long evaluations;    // Function and gradient evaluations spent
+    bool cached;                  // Whether the climb stopped in a known basin
+};
+
+// ClimbStarts: Claims starts one at a time from next and climbs from each
+// with its own engine, consulting and then extending the cache if given
+void ClimbStarts(const SumofGaussians& gauss_sum, int dimensions, const string& method,
+                 const vector<vector<double>>& starts, vector<ClimbResult>& results,
+                 atomic<int>& next, basin_cache* cache);
+
+// Mainline logic
+int main(int argc, char** argv)
+{
+    // Variables for storing the number of summands and dimensions
+    int dimens, summands;
+
+    // Separate the option flags from the positional arguments
+    search_options options;
+    argc = ParseSearchOptions(argc, argv, options);
+
+    // A cacheless run is kept for comparison
+    bool use_cache = options.use_cache;
+
+    // Check command line arguments for errors
+    if (argc < 4 || argc > 7)
+    {
+        cout << "Usage: ./multistart <random number seed> <dimensions> <number of random variables> [fixed|momentum|nesterov|adam|lbfgs] [starts] [threads (0 = one per core)] [-n (no basin cache)] [-q | -e <k>] [-t <trace file>] [-l <landscape file>]" << endl;
+        return 1;
+    }
+
+    ios_base::sync_with_stdio(false);
+
+    // Read command line arguments into variables
+    dimens = atoi(argv[2]);
+    summands = atoi(argv[3]);
+    string method = (argc > 4) ? argv[4] : "fixed";
+    int start_count = (argc > 5) ? atoi(argv[5]) : DEFAULT_STARTS;
+    int threads = (argc > 6) ? atoi(argv[6]) : 0;
+    if (threads < 1)
+        threads = (thread::hardware_concurrency() > 0) ? thread::hardware_concurrency() : 1;
+
+    // Seed the landscape and the search with separate streams of the
+    // command line argument, so the search starts from the same points
+    // whether the landscape is generated or loaded from a file
+    xoshiro256 landscape_rng(atoi(argv[1]));
+    xoshiro256 rng = xoshiro256::Stream(atoi(argv[1]), 1);
+
+    // Compute a sum of Gaussians, or load a saved one whose size must
+    // match the one given so the arguments still describe the search
+    SumofGaussians* landscape = options.landscape_path.empty()
+                                ? new SumofGaussians(dimens, summands, landscape_rng)
+                                : new SumofGaussians(options.landscape_path.c_str());
+    if (!options.landscape_path.empty() && (landscape->dimensions() != dimens || landscape->count() != summands))
+    {
+        cout << "Unable to load a landscape of " << summands << " centers in " << dimens
+             << " dimensions from: " << options.landscape_path << endl;
+        delete landscape;
+        return 1;
+    }
+    SumofGaussians& sum_func = *landscape;
+
+    ascent_optimizer* check = MakeOptimizer(method, sum_func, dimens, EPSILON/STEP_SIZE, STEP_SIZE);
+    if (check == nullptr)
+    {
+        cout << "Unknown optimizer: " << method << endl;
+        delete landscape;
+        return 1;
+    }
+    delete check;
+
+    trace_writer trace;
+    if (!options.trace_path.empty() && !trace.Open(options.trace_path, dimens))
+    {
+        cout << "Unable to open trace file: " << options.trace_path << endl;
+        delete landscape;
+        return 1;
+    }
+
+    // Draw every start up front so they do not depend on the threads
+    vector<vector<double>> starts(start_count, vector<double>(dimens));
+    for (int s = 0; s < start_count; ++s)
+        rng.Uniform(starts[s].data(), dimens, 0.0, 10.0);
+
+    // Climb from every start
+    basin_cache cache(dimens, CELL_SIZE);
+    vector<ClimbResult> results(start_count);
+    atomic<int> next(0);
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t)
+        workers.emplace_back(ClimbStarts, cref(sum_func), dimens, cref(method), cref(starts), ref(results),
+                             ref(next), use_cache ? &cache : nullptr);
+    ClimbStarts(sum_func, dimens, method, starts, results, next, use_cache ? &cache : nullptr);
+    for (thread& worker : workers)
+        worker.join();
+
+    // Print the value reached from each start, and whether it was cached,
+    // tracing the maximum reached from each
+    int best = 0;
+    unsigned long iterations = 0, evaluations = 0, cached = 0;
+    for (int s = 0; s < start_count; ++s)
+    {
+        if (ShouldPrint(options, s))
+            cout << results[s].value << " " << results[s].iterations << (results[s].cached ? " cached" : "") << '\n';
+
+        if (trace.IsOpen())
+            trace.Record(s, results[s].value, results[s].preimage.data());
+
+        if (results[s].value > results[best].value)
+            best = s;
+        iterations += results[s].iterations;
+        evaluations += results[s].evaluations;
+        cached += results[s].cached;
+    }
+
+    // Print the best results found
+    for (int l = 0; l < dimens; ++l)
+        cout << results[best].preimage[l] << " ";
+    cout << results[best].value << endl;
+
+    cerr << method << ": " << start_count << " starts, " << iterations << " iterations, "
+         << evaluations << " evaluations, " << cached << " stopped in known basins, "
+         << cache.Basins() << " basins, " << cache.Cells() << " cells" << endl;
+
+    delete landscape;
+
+    return 0;
+}
+
+// ClimbStarts: Claims starts one at a time from next and climbs from each
+// with its own engine, consulting and then extending the cache if given
+void ClimbStarts(const SumofGaussians& gauss_sum, int dimensions, const string& method,
+                 const vector<vector<double>>& starts, vector<ClimbResult>& results,
+                 atomic<int>& next, basin_cache* cache)
+{
+    ascent_optimizer* climber = MakeOptimizer(method, gauss_sum, dimensions, EPSILON/STEP_SIZE, STEP_SIZE);
+    vector<uint64_t> path;
+
+    for (int s = next++; s < int(starts.size()); s = next++)
+    {
+        ClimbResult& result = results[s];
+        result.preimage.resize(dimensions);
+        result.cached = false;
+        path.clear();
+
+        climber->Start(starts[s].data());
+        int basin = -1;
+        while (!climber->Converged() && climber->Iterations() < MAX_ITERATIONS)
+        {
+            // Look up each new cell the climb enters, stopping in a known basin
+            if (cache != nullptr)
+            {
+                uint64_t key = cache->Cell(climber->Preimage());
+                if (path.empty() || path.back() != key)
+                {
+                    path.push_back(key);
+                    basin = cache->Lookup(key);
+                    if (basin >= 0)
+                        break;
+                }
+            }
+
+            climber->Step();
+        }
+
+        result.iterations = climber->Iterations();
+        result.evaluations = climber->Evaluations() + climber->GradientEvaluations();
+
+        if (basin >= 0)
+        {
+            result.value = cache->Maximum(basin, result.preimage.data());
+            result.cached = true;
+        }
+        else
+        {
+            for (int i = 0; i < dimensions; ++i)
+                result.preimage[i] = climber->Preimage()[i];
+            result.value = gauss_sum.eval(result.preimage.data());
+            ++result.evaluations;
+        }
+
+        // Every cell of the path leads to the same maximum, whether it was
+        // climbed or found in the cache. Only climbs that moved and then
+        // converged found a maximum: a start that converges at once lies
+        // where the sum is flat, and a climb cut off has not arrived.
+        if (cache != nullptr)
+        {
+            if (basin < 0 && climber->Converged() && climber->Iterations() > 0)
+                basin = cache->AddMaximum(result.preimage.data(), result.value);
+            if (basin >= 0)
+                cache->Record(path, basin);
+        }
+    }
+
+    delete climber;
+}
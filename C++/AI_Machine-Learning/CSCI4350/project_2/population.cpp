@@ -0,0 +1,119 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: population.cpp
+ *    File Description: This file runs a population based
+ *    search (CMA-ES or differential evolution) to find
+ *    a maximum on a sum of Gaussian random variables,
+ *    reporting the best value against the number of
+ *    evaluations so it can be compared with greedy and sa.
+ *
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+
+#define DEFAULT_BUDGET 100000   // Evaluation budget when none is given
+
+#include "SumofGaussians.h"
+#include "rng.h"
+#include "trace.h"
+#include "batch_evaluator.h"
+#include "population_optimizers.h"
+
+using namespace std;
+
+// Mainline logic
+int main(int argc, char** argv)
+{
+    // Variables for storing the number of summands and dimensions
+    int dimens, summands;
+
+    // Separate the option flags from the positional arguments
+    search_options options;
+    argc = ParseSearchOptions(argc, argv, options);
+
+    // Check command line arguments for errors
+    if (argc != 5 && argc != 6)
+    {
+        cout << "Usage: ./population <random number seed> <dimensions> <number of random variables> <cmaes|de>[-mixed] [evaluation budget] [-q | -e <k>] [-t <trace file>] [-l <landscape file>]" << endl;
+        return 1;
+    }
+
+    ios_base::sync_with_stdio(false);
+
+    // Read command line arguments into variables
+    dimens = atoi(argv[2]);
+    summands = atoi(argv[3]);
+    unsigned long budget = (argc == 6) ? strtoul(argv[5], nullptr, 10) : DEFAULT_BUDGET;
+
+    // Seed the landscape and the search with separate streams of the
+    // command line argument, so the search starts from the same points
+    // whether the landscape is generated or loaded from a file
+    xoshiro256 landscape_rng(atoi(argv[1]));
+    xoshiro256 rng = xoshiro256::Stream(atoi(argv[1]), 1);
+
+    // Compute a sum of Gaussians, or load a saved one whose size must
+    // match the one given so the arguments still describe the search
+    SumofGaussians* landscape = options.landscape_path.empty()
+                                ? new SumofGaussians(dimens, summands, landscape_rng)
+                                : new SumofGaussians(options.landscape_path.c_str());
+    if (!options.landscape_path.empty() && (landscape->dimensions() != dimens || landscape->count() != summands))
+    {
+        cout << "Unable to load a landscape of " << summands << " centers in " << dimens
+             << " dimensions from: " << options.landscape_path << endl;
+        delete landscape;
+        return 1;
+    }
+    SumofGaussians& sum_func = *landscape;
+
+    // Evaluate each generation across every core
+    batch_evaluator evaluator(sum_func, dimens);
+
+    population_optimizer* search = MakePopulationOptimizer(argv[4], evaluator, dimens, rng);
+    if (search == nullptr)
+    {
+        cout << "Unknown search: " << argv[4] << endl;
+        delete landscape;
+        return 1;
+    }
+
+    trace_writer trace;
+    if (!options.trace_path.empty() && !trace.Open(options.trace_path, dimens))
+    {
+        cout << "Unable to open trace file: " << options.trace_path << endl;
+        delete search;
+        delete landscape;
+        return 1;
+    }
+
+    // Run generations until the search stops or the budget is spent,
+    // printing the evaluations spent and the best value after each
+    search->Start();
+    do
+    {
+        if (ShouldPrint(options, search->Generations()))
+            cout << search->Evaluations() << " " << search->BestValue() << '\n';
+
+        if (trace.IsOpen())
+            trace.Record(search->Evaluations(), search->BestValue(), search->BestPoint());
+    }
+    while (search->Evaluations() < budget && search->Step());
+
+    // Print the best results found
+    for(int l = 0; l < dimens; ++l)
+        cout << search->BestPoint()[l] << " ";
+    cout << search->BestValue() << endl;
+
+    cerr << search->Name() << ": " << search->Generations() << " generations, "
+         << search->Evaluations() << " evaluations" << endl;
+
+    delete search;
+    delete landscape;
+
+    return 0;
+}
@@ -0,0 +1,550 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: population_optimizers.h
+ *    File Description: Header file containing a common interface
+ *    for population based searches on a sum of Gaussians along with
+ *    CMA-ES and differential evolution implementations. Every
+ *    generation is evaluated as one batch by a batch_evaluator,
+ *    optionally in single precision until the search settles.
+ *
+ */
+
+#ifndef POPULATION_OPTIMIZERS
+#define POPULATION_OPTIMIZERS
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+#include "SumofGaussians.h"
+#include "batch_evaluator.h"
+#include "rng.h"
+
+#define SINGLE_TOLERANCE  1e-5   // Relative improvement resolvable in single precision
+#define SINGLE_PATIENCE   10     // Stalled single precision generations before refining in double
+
+// population_optimizer: Base class of the population based searches. A
+// search is begun with Start and advanced one generation at a time with
+// Step until Stopped reports that it stagnated or converged. The best
+// point seen and the evaluations spent are tracked so that searches can
+// be compared with greedy and sa at equal evaluation budgets.
+class population_optimizer
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // population_optimizer constructor: Binds the search to an evaluator
+        // and a generator. The search stops once the best value has not
+        // improved by more than tolerance (relative) for patience generations.
+        // Relative tests matter here, since far from every center the
+        // values are tiny but still differ by orders of magnitude.
+        population_optimizer(batch_evaluator& batch, int dimensions, xoshiro256& generator,
+                             unsigned int patience, double tolerance)
+            : evaluator(batch), dims(dimensions), rng(generator), stall_limit(patience), tol(tolerance),
+              best_point(dimensions)
+        {
+            mixed = false;
+            Clear();
+            return;
+        }
+
+        virtual ~population_optimizer() {}
+
+        // UseMixedPrecision: When enabled, searches begin in single precision
+        // and switch to double once single precision stops making progress
+        void UseMixedPrecision(bool enable)
+        {
+            mixed = enable;
+            return;
+        }
+
+        // Start: Begins a new search from a random population in the [0,10] cube
+        void Start()
+        {
+            Clear();
+            single_phase = mixed;
+            evaluator.SetSinglePrecision(single_phase);
+            Initialize();
+            return;
+        }
+
+        // Step: Runs a single generation. Returns false without doing
+        // anything if the search has already stopped.
+        bool Step()
+        {
+            if(Stopped())
+                return false;
+
+            double previous = best_value;
+            Generation();
+            ++generations;
+
+            // Improvements below the error of single precision are noise
+            double threshold = single_phase ? SINGLE_TOLERANCE : tol;
+            if(best_value - previous > threshold*fabs(previous))
+                stalled = 0;
+            else
+                ++stalled;
+
+            if(single_phase && (converged || stalled >= SINGLE_PATIENCE))
+                Refine();
+
+            return true;
+        }
+
+        // Stopped: True once the search stagnated or converged
+        bool Stopped() const
+        {
+            return converged || stalled >= stall_limit;
+        }
+
+        // Accessors for the state and cost of the search
+        const double* BestPoint() const        { return best_point.data(); }
+        double BestValue() const               { return best_value; }
+        unsigned long Generations() const      { return generations; }
+        unsigned long Evaluations() const      { return evaluations; }
+        bool SinglePhase() const               { return single_phase; }
+
+        // Name: Name of the search used when reporting results
+        virtual std::string Name() const = 0;
+
+    // ******************** PROTECTED CLASS CONTENTS ******************** \\
+
+    protected:
+
+        batch_evaluator& evaluator;  // Evaluates each generation in parallel
+        int dims;                    // Number of dimensions of the search space
+        xoshiro256& rng;             // Source of all random draws
+        bool converged;              // Set by a search whose own stopping rule fired
+
+        // Initialize: Creates and evaluates the first population
+        virtual void Initialize() = 0;
+
+        // Generation: Creates, evaluates and selects one generation
+        virtual void Generation() = 0;
+
+        // Refined: Called after switching to double precision, for searches
+        // that keep values from earlier generations
+        virtual void Refined() {}
+
+        // Evaluate: Evaluates count points laid out one after another and
+        // records the best of them
+        void Evaluate(const std::vector<double>& points, int count, std::vector<double>& values)
+        {
+            values.resize(count);
+            evaluator.Evaluate(points.data(), count, values.data());
+            evaluations += count;
+
+            for(int i = 0; i < count; ++i)
+            {
+                if(values[i] > best_value)
+                {
+                    best_value = values[i];
+                    std::copy(points.begin() + long(i)*dims, points.begin() + long(i + 1)*dims, best_point.begin());
+                }
+            }
+            return;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        unsigned int stall_limit;         // Generations without improvement before stopping
+        double tol;                       // Relative improvement considered progress
+        unsigned int stalled;             // Generations since the last improvement
+        unsigned long generations;        // Generations run in the current search
+        unsigned long evaluations;        // Evaluations spent in the current search
+        double best_value;                // Best value seen
+        std::vector<double> best_point;   // Preimage of the best value
+        bool mixed;                       // Whether searches begin in single precision
+        bool single_phase;                // Whether the evaluator is in single precision
+
+        // Refine: Switches to double precision and corrects the best value,
+        // which may have been rounded up in single precision
+        void Refine()
+        {
+            single_phase = false;
+            evaluator.SetSinglePrecision(false);
+            converged = false;
+            stalled = 0;
+
+            evaluator.Evaluate(best_point.data(), 1, &best_value);
+            ++evaluations;
+
+            Refined();
+            return;
+        }
+
+        // Clear: Forgets the previous search
+        void Clear()
+        {
+            converged = false;
+            single_phase = false;
+            stalled = 0;
+            generations = 0;
+            evaluations = 0;
+            best_value = -1.0;
+            return;
+        }
+
+};
+
+// cmaes: Covariance matrix adaptation evolution strategy (Hansen's
+// (mu/mu_w, lambda) form with cumulative step-size adaptation). New points
+// are drawn from a normal distribution whose mean, shape and size are
+// fitted to the best points of each generation.
+class cmaes : public population_optimizer
+{
+    public:
+
+        // cmaes constructor: A population of 0 uses the default 4 + 3 ln(D)
+        cmaes(batch_evaluator& batch, int dimensions, xoshiro256& generator,
+              unsigned int patience = 50, double tolerance = 1e-12, int population = 0, double initial_sigma = 2.0)
+            : population_optimizer(batch, dimensions, generator, patience, tolerance), sigma0(initial_sigma)
+        {
+            lambda = (population > 0) ? population : 4 + int(3.0*log(double(dims)));
+            mu = lambda/2;
+
+            // Log-linear recombination weights
+            weights.resize(mu);
+            for(int i = 0; i < mu; ++i)
+                weights[i] = log(mu + 0.5) - log(i + 1.0);
+            double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+            double squares = 0.0;
+            for(int i = 0; i < mu; ++i)
+            {
+                weights[i] /= total;
+                squares += weights[i]*weights[i];
+            }
+            mu_eff = 1.0/squares;
+
+            // Learning rates of the step size and covariance
+            double n = dims;
+            c_sigma = (mu_eff + 2.0)/(n + mu_eff + 5.0);
+            d_sigma = 1.0 + 2.0*std::max(0.0, sqrt((mu_eff - 1.0)/(n + 1.0)) - 1.0) + c_sigma;
+            c_c = (4.0 + mu_eff/n)/(n + 4.0 + 2.0*mu_eff/n);
+            c_1 = 2.0/((n + 1.3)*(n + 1.3) + mu_eff);
+            c_mu = std::min(1.0 - c_1, 2.0*(mu_eff - 2.0 + 1.0/mu_eff)/((n + 2.0)*(n + 2.0) + mu_eff));
+            chi_n = sqrt(n)*(1.0 - 1.0/(4.0*n) + 1.0/(21.0*n*n));
+
+            // Decompose the covariance only as often as it changes noticeably
+            eigen_interval = std::max(1, int(1.0/((c_1 + c_mu)*n*10.0)));
+            return;
+        }
+
+        std::string Name() const { return "cmaes"; }
+
+    protected:
+
+        int lambda, mu;                  // Points sampled and points recombined per generation
+        double sigma0;                   // Initial step size
+        std::vector<double> weights;     // Recombination weights of the mu best points
+        double mu_eff;                   // Variance effective selection mass
+        double c_sigma, d_sigma;         // Step-size learning rate and damping
+        double c_c, c_1, c_mu;           // Covariance path, rank-one and rank-mu learning rates
+        double chi_n;                    // Expected length of a standard normal vector
+        int eigen_interval;              // Generations between decompositions
+
+        double sigma;                    // Current step size
+        std::vector<double> mean;        // Current mean
+        std::vector<double> p_sigma;     // Conjugate evolution path
+        std::vector<double> p_c;         // Covariance evolution path
+        std::vector<double> C;           // Covariance matrix, row-major
+        std::vector<double> B;           // Eigenvectors of C, one per column
+        std::vector<double> eigen;       // Square roots of the eigenvalues of C
+        std::vector<double> z, y;        // Standard and shaped samples, row-major
+        std::vector<double> points;      // Sampled points, row-major
+        std::vector<double> values;      // Values of the sampled points
+        std::vector<int> order;          // Sample indices sorted best first
+
+        void Initialize()
+        {
+            sigma = sigma0;
+            mean.resize(dims);
+            rng.Uniform(mean.data(), dims, 0.0, 10.0);
+            p_sigma.assign(dims, 0.0);
+            p_c.assign(dims, 0.0);
+
+            C.assign(dims*dims, 0.0);
+            B.assign(dims*dims, 0.0);
+            for(int i = 0; i < dims; ++i)
+                C[i*dims + i] = B[i*dims + i] = 1.0;
+            eigen.assign(dims, 1.0);
+
+            z.resize(long(lambda)*dims);
+            y.resize(long(lambda)*dims);
+            points.resize(long(lambda)*dims);
+            order.resize(lambda);
+
+            // The first generation is sampled around a random mean
+            Generation();
+            return;
+        }
+
+        void Generation()
+        {
+            // Sample lambda points: y = B * diag(eigen) * z, x = mean + sigma * y
+            rng.Normal(z.data(), lambda*dims);
+            for(int k = 0; k < lambda; ++k)
+            {
+                for(int i = 0; i < dims; ++i)
+                {
+                    double total = 0.0;
+                    for(int j = 0; j < dims; ++j)
+                        total += B[i*dims + j]*eigen[j]*z[k*dims + j];
+                    y[k*dims + i] = total;
+                    points[k*dims + i] = mean[i] + sigma*total;
+                }
+            }
+
+            Evaluate(points, lambda, values);
+
+            // Rank the samples from highest to lowest value
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](int a, int b){ return values[a] > values[b]; });
+
+            // Move the mean to the weighted average of the mu best
+            std::vector<double> y_w(dims, 0.0);
+            for(int r = 0; r < mu; ++r)
+                for(int i = 0; i < dims; ++i)
+                    y_w[i] += weights[r]*y[order[r]*dims + i];
+            for(int i = 0; i < dims; ++i)
+                mean[i] += sigma*y_w[i];
+
+            // Conjugate path uses C^(-1/2) y_w = B diag(1/eigen) B^T y_w
+            std::vector<double> rotated(dims, 0.0);
+            for(int j = 0; j < dims; ++j)
+            {
+                double total = 0.0;
+                for(int i = 0; i < dims; ++i)
+                    total += B[i*dims + j]*y_w[i];
+                rotated[j] = total/eigen[j];
+            }
+            double path_scale = sqrt(c_sigma*(2.0 - c_sigma)*mu_eff);
+            double path_norm = 0.0;
+            for(int i = 0; i < dims; ++i)
+            {
+                double total = 0.0;
+                for(int j = 0; j < dims; ++j)
+                    total += B[i*dims + j]*rotated[j];
+                p_sigma[i] = (1.0 - c_sigma)*p_sigma[i] + path_scale*total;
+                path_norm += p_sigma[i]*p_sigma[i];
+            }
+            path_norm = sqrt(path_norm);
+
+            // Stall the covariance path while the step size is growing quickly
+            double correction = sqrt(1.0 - pow(1.0 - c_sigma, 2.0*(Generations() + 1)));
+            bool h_sigma = path_norm/correction < (1.4 + 2.0/(dims + 1.0))*chi_n;
+            double c_scale = sqrt(c_c*(2.0 - c_c)*mu_eff);
+            for(int i = 0; i < dims; ++i)
+                p_c[i] = (1.0 - c_c)*p_c[i] + (h_sigma ? c_scale*y_w[i] : 0.0);
+
+            // Rank-one and rank-mu covariance update
+            double keep = 1.0 - c_1 - c_mu + (h_sigma ? 0.0 : c_1*c_c*(2.0 - c_c));
+            for(int i = 0; i < dims; ++i)
+            {
+                for(int j = 0; j <= i; ++j)
+                {
+                    double rank_mu = 0.0;
+                    for(int r = 0; r < mu; ++r)
+                        rank_mu += weights[r]*y[order[r]*dims + i]*y[order[r]*dims + j];
+
+                    double entry = keep*C[i*dims + j] + c_1*p_c[i]*p_c[j] + c_mu*rank_mu;
+                    C[i*dims + j] = C[j*dims + i] = entry;
+                }
+            }
+
+            // Cumulative step-size adaptation
+            sigma *= exp((c_sigma/d_sigma)*(path_norm/chi_n - 1.0));
+
+            if((Generations() + 1) % eigen_interval == 0)
+                Decompose();
+
+            // Converged once the sampling distribution has collapsed
+            if(sigma*(*std::max_element(eigen.begin(), eigen.end())) < 1e-12)
+                converged = true;
+            return;
+        }
+
+    private:
+
+        // Decompose: Refreshes B and eigen from C with cyclic Jacobi rotations
+        void Decompose()
+        {
+            std::vector<double> A = C;
+            B.assign(dims*dims, 0.0);
+            for(int i = 0; i < dims; ++i)
+                B[i*dims + i] = 1.0;
+
+            for(int sweep = 0; sweep < 50; ++sweep)
+            {
+                double off = 0.0;
+                for(int p = 0; p < dims; ++p)
+                    for(int q = p + 1; q < dims; ++q)
+                        off += A[p*dims + q]*A[p*dims + q];
+                if(off < 1e-30)
+                    break;
+
+                for(int p = 0; p < dims; ++p)
+                {
+                    for(int q = p + 1; q < dims; ++q)
+                    {
+                        double apq = A[p*dims + q];
+                        if(fabs(apq) < 1e-300)
+                            continue;
+
+                        // Rotation angle that zeroes A[p][q]
+                        double theta = (A[q*dims + q] - A[p*dims + p])/(2.0*apq);
+                        double t = ((theta >= 0.0) ? 1.0 : -1.0)/(fabs(theta) + sqrt(theta*theta + 1.0));
+                        double c = 1.0/sqrt(t*t + 1.0);
+                        double s = t*c;
+
+                        for(int k = 0; k < dims; ++k)
+                        {
+                            double akp = A[k*dims + p], akq = A[k*dims + q];
+                            A[k*dims + p] = c*akp - s*akq;
+                            A[k*dims + q] = s*akp + c*akq;
+                        }
+                        for(int k = 0; k < dims; ++k)
+                        {
+                            double apk = A[p*dims + k], aqk = A[q*dims + k];
+                            A[p*dims + k] = c*apk - s*aqk;
+                            A[q*dims + k] = s*apk + c*aqk;
+                        }
+                        for(int k = 0; k < dims; ++k)
+                        {
+                            double bkp = B[k*dims + p], bkq = B[k*dims + q];
+                            B[k*dims + p] = c*bkp - s*bkq;
+                            B[k*dims + q] = s*bkp + c*bkq;
+                        }
+                    }
+                }
+            }
+
+            // Guard against eigenvalues lost to round-off
+            for(int i = 0; i < dims; ++i)
+                eigen[i] = sqrt(std::max(A[i*dims + i], 1e-20));
+            return;
+        }
+};
+
+// differential_evolution: DE/rand/1/bin. Each member is challenged by a
+// trial point built from the scaled difference of two random members added
+// to a third, crossed over with the member, and replaced if the trial is
+// at least as good.
+class differential_evolution : public population_optimizer
+{
+    public:
+
+        // differential_evolution constructor: A population of 0 uses 10 D,
+        // limited to between 20 and 200 members
+        differential_evolution(batch_evaluator& batch, int dimensions, xoshiro256& generator,
+                               unsigned int patience = 50, double tolerance = 1e-12, int population = 0,
+                               double weight = 0.5, double crossover = 0.9)
+            : population_optimizer(batch, dimensions, generator, patience, tolerance), F(weight), CR(crossover)
+        {
+            members = (population > 0) ? population : std::min(200, std::max(20, 10*dims));
+            return;
+        }
+
+        std::string Name() const { return "de"; }
+
+    protected:
+
+        int members;                     // Population size
+        double F;                        // Differential weight
+        double CR;                       // Crossover probability
+        std::vector<double> current;     // Population, row-major
+        std::vector<double> fitness;     // Values of the population
+        std::vector<double> trials;      // Trial points, row-major
+        std::vector<double> trial_values;// Values of the trial points
+
+        void Initialize()
+        {
+            current.resize(long(members)*dims);
+            trials.resize(long(members)*dims);
+            rng.Uniform(current.data(), members*dims, 0.0, 10.0);
+            Evaluate(current, members, fitness);
+            return;
+        }
+
+        // Fitness found in single precision is recomputed so that selection
+        // compares double values with double values
+        void Refined()
+        {
+            Evaluate(current, members, fitness);
+            return;
+        }
+
+        void Generation()
+        {
+            for(int k = 0; k < members; ++k)
+            {
+                // Three distinct members other than k
+                int a, b, c;
+                do { a = rng.Below(members); } while(a == k);
+                do { b = rng.Below(members); } while(b == k || b == a);
+                do { c = rng.Below(members); } while(c == k || c == a || c == b);
+
+                // Binomial crossover, forcing at least one mutated component
+                int forced = rng.Below(dims);
+                for(int i = 0; i < dims; ++i)
+                {
+                    if(i == forced || rng.Uniform() < CR)
+                        trials[k*dims + i] = current[a*dims + i] + F*(current[b*dims + i] - current[c*dims + i]);
+                    else
+                        trials[k*dims + i] = current[k*dims + i];
+                }
+            }
+
+            Evaluate(trials, members, trial_values);
+
+            // One-to-one selection
+            double spread = 0.0;
+            for(int k = 0; k < members; ++k)
+            {
+                if(trial_values[k] >= fitness[k])
+                {
+                    std::copy(trials.begin() + long(k)*dims, trials.begin() + long(k + 1)*dims, current.begin() + long(k)*dims);
+                    fitness[k] = trial_values[k];
+                }
+                spread = std::max(spread, fabs(fitness[k] - BestValue()));
+            }
+
+            // Converged once every member shares the best value, which a
+            // population that has yet to find any Gaussian never does
+            if(BestValue() > 0.0 && spread <= 1e-15*BestValue())
+                converged = true;
+            return;
+        }
+};
+
+// MakePopulationOptimizer: Creates the search with the given name, or
+// returns nullptr if no search has that name. A "-mixed" suffix starts the
+// search in single precision. The caller owns the result.
+inline population_optimizer* MakePopulationOptimizer(const std::string& name, batch_evaluator& batch, int dimensions,
+                                                     xoshiro256& generator)
+{
+    const std::string suffix = "-mixed";
+    bool mixed = name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+    std::string base = mixed ? name.substr(0, name.size() - suffix.size()) : name;
+
+    population_optimizer* search = nullptr;
+    if(base == "cmaes")    search = new cmaes(batch, dimensions, generator);
+    if(base == "de")       search = new differential_evolution(batch, dimensions, generator);
+
+    if(search != nullptr)
+        search->UseMixedPrecision(mixed);
+    return search;
+}
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: race.cpp
+ *    File Description: This file starts many searches from
+ *    random points on a sum of Gaussian random variables and
+ *    races them by successive halving, so that most of the
+ *    computation goes to the starts that look most promising.
+ *
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define EPSILON        0.00000001  // Error tolerance for convergence
+#define STEP_SIZE      0.01        // Step size of the gradient ascent engines
+#define SA_STEP_SIZE   0.1         // Perturbation size of simulated annealing
+#define SA_STEPS       7500        // Steps in each annealing run
+#define MAX_ITERATIONS 10000000    // Iteration limit for engines that may not settle
+#define DEFAULT_STARTS 256         // Searches raced when no count is given
+#define FIRST_BUDGET   16          // Steps every search takes in the first rung
+#define REDUCTION      4           // Fraction of the searches dropped by each rung is 1 - 1/REDUCTION
+
+#include "SumofGaussians.h"
+#include "rng.h"
+#include "trace.h"
+#include "ascent_optimizers.h"
+#include "annealing.h"
+#include "scheduler.h"
+
+using namespace std;
+
+// Mainline logic
+int main(int argc, char** argv)
+{
+    // Variables for storing the number of summands and dimensions
+    int dimens, summands;
+
+    // Separate the option flags from the positional arguments
+    search_options options;
+    argc = ParseSearchOptions(argc, argv, options);
+
+    // Check command line arguments for errors
+    if (argc < 4 || argc > 7)
+    {
+        cout << "Usage: ./race <random number seed> <dimensions> <number of random variables> [fixed|momentum|nesterov|adam|lbfgs|sa] [starts] [threads (0 = one per core)] [-q | -e <k>] [-t <trace file>] [-l <landscape file>]" << endl;
+        return 1;
+    }
+
+    ios_base::sync_with_stdio(false);
+
+    // Read command line arguments into variables
+    dimens = atoi(argv[2]);
+    summands = atoi(argv[3]);
+    string method = (argc > 4) ? argv[4] : "fixed";
+    int starts = (argc > 5) ? atoi(argv[5]) : DEFAULT_STARTS;
+    unsigned int threads = (argc > 6) ? atoi(argv[6]) : 0;
+    if (starts < 1)
+        starts = 1;
+
+    // Seed the landscape and the search with separate streams of the
+    // command line argument, so the search starts from the same points
+    // whether the landscape is generated or loaded from a file
+    xoshiro256 landscape_rng(atoi(argv[1]));
+    xoshiro256 rng = xoshiro256::Stream(atoi(argv[1]), 1);
+
+    // Compute a sum of Gaussians, or load a saved one whose size must
+    // match the one given so the arguments still describe the search
+    SumofGaussians* landscape = options.landscape_path.empty()
+                                ? new SumofGaussians(dimens, summands, landscape_rng)
+                                : new SumofGaussians(options.landscape_path.c_str());
+    if (!options.landscape_path.empty() && (landscape->dimensions() != dimens || landscape->count() != summands))
+    {
+        cout << "Unable to load a landscape of " << summands << " centers in " << dimens
+             << " dimensions from: " << options.landscape_path << endl;
+        delete landscape;
+        return 1;
+    }
+    SumofGaussians& sum_func = *landscape;
+
+    // Create a search from each random start, each with its own stream.
+    // The ascent tolerance matches greedy's |STEP_SIZE*grad| < EPSILON.
+    bool annealing = (method == "sa");
+    vector<search_task*> tasks;
+    vector<double> start(dimens);
+    xoshiro256 stream = rng;
+    for (int s = 0; s < starts; ++s)
+    {
+        rng.Uniform(start.data(), dimens, 0.0, 10.0);
+        stream.Jump();
+
+        search_task* task = MakeTask(method, sum_func, dimens, stream, start.data(), EPSILON/STEP_SIZE,
+                                     annealing ? SA_STEP_SIZE : STEP_SIZE, annealing ? SA_STEPS : MAX_ITERATIONS);
+        if (task == nullptr)
+        {
+            cout << "Unknown search: " << method << endl;
+            delete landscape;
+            return 1;
+        }
+        tasks.push_back(task);
+    }
+
+    trace_writer trace;
+    if (!options.trace_path.empty() && !trace.Open(options.trace_path, dimens))
+    {
+        cout << "Unable to open trace file: " << options.trace_path << endl;
+        for (search_task* task : tasks)
+            delete task;
+        delete landscape;
+        return 1;
+    }
+
+    // Race the searches, printing the survivors, the evaluations spent
+    // and the best value after each rung
+    successive_halving race(tasks, FIRST_BUDGET, REDUCTION, threads);
+    while (race.Rung())
+    {
+        if (ShouldPrint(options, race.Rungs() - 1))
+            cout << race.Survivors() << " " << race.Evaluations() << " " << race.Best().Value() << '\n';
+
+        if (trace.IsOpen())
+            trace.Record(race.Evaluations(), race.Best().Value(), race.Best().Point());
+    }
+
+    // Print the best results found
+    for(int l = 0; l < dimens; ++l)
+        cout << race.Best().Point()[l] << " ";
+    cout << race.Best().Value() << endl;
+
+    cerr << method << ": " << starts << " starts, " << race.Rungs() << " rungs, "
+         << race.Evaluations() << " evaluations" << endl;
+
+    delete landscape;
+
+    return 0;
+}
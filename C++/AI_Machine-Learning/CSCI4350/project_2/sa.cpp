@@ -16,20 +16,76 @@
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #define EPSILON   0.00000001  // Error tolerance for convergence
 #define STEP_SIZE 0.1        // Step size of greedy hill climb
-#define INV_STEP  10         // Reciporical of step size for computing divergence
-#define ANNEAL    7510.0     // An annealing constant for giving a base temperature
+
+#define SA_STEPS        7500   // Metropolis steps taken by simulated annealing
+
+#define PT_STEPS      7500   // Metropolis steps taken by every replica in parallel tempering
+#define SWAP_INTERVAL 50     // Metropolis steps each replica takes between exchange attempts
+#define PT_T_MIN      0.001  // Temperature of the coldest replica
+#define PT_T_MAX      1.0    // Temperature of the hottest replica
 
 #include "SumofGaussians.h"
+#include "rng.h"
+#include "trace.h"
+#include "annealing.h"
 
 using namespace std;
 
-// Laplacian: Computes the Laplacian ( divergence of the gradient )
-// of a vector along the sum of Gaussians function using forward
-// difference approximation
-double Laplacian(double vector[], int dimensions, SumofGaussians gauss_sum);
+// Replica: A single Metropolis chain used by parallel tempering. The
+// chain's temperature and step size are fixed to its slot in the ladder,
+// while the preimage and value are exchanged with neighboring slots.
+struct Replica
+{
+    vector<double> preimage;   // Current state of the chain
+    double value;                   // Function value at the current state
+    double temperature;             // Temperature of this slot in the ladder
+    double step;                    // Maximum perturbation of each component
+    xoshiro256 engine;         // Private random stream of the chain
+};
+
+// BestSoFar: Best preimage seen by any replica, shared between threads
+struct BestSoFar
+{
+    mutex lock;
+    vector<double> preimage;
+    double value;
+};
+
+// EpochGate: Lets the tempering workers, started once per run, wait for
+// each epoch to begin and the main thread wait for them to finish it
+struct EpochGate
+{
+    mutex lock;                    // Guards everything below
+    condition_variable start;      // Signals a new epoch or shutdown
+    condition_variable done;       // Signals that the workers finished the epoch
+    unsigned long epoch = 0;       // Number of the current epoch
+    int pending = 0;               // Workers still advancing their replicas
+    bool stopping = false;         // Whether the workers should exit
+};
+
+// ParallelTempering: Runs a number of Metropolis chains at geometrically
+// spaced temperatures across all available cores, periodically attempting
+// to exchange states between neighboring temperatures. Returns the best
+// value found and stores its preimage in best_point. Each chain draws from
+// its own stream jumped ahead of rng, which makes exchange decisions.
+double ParallelTempering(const SumofGaussians& gauss_sum, int dimensions, int replicas, xoshiro256& rng, double best_point[],
+                         const search_options& options, trace_writer& trace);
+
+// AdvanceReplicas: Advances every stride-th replica starting at first by
+// SWAP_INTERVAL Metropolis steps and records any improvement in best.
+void AdvanceReplicas(const SumofGaussians& gauss_sum, vector<Replica>& chains, int first, int stride, BestSoFar& best);
+
+// TemperReplicas: Body of each tempering worker, which advances its
+// replicas once per epoch opened by gate until the run is over
+void TemperReplicas(const SumofGaussians& gauss_sum, vector<Replica>& chains, int first, int stride, BestSoFar& best,
+                    EpochGate& gate);
 
 // Mainline logic
 int main(int argc, char** argv)
@@ -37,158 +93,288 @@ int main(int argc, char** argv)
     // Variables for storing the number of summands and dimensions
     int dimens, summands;
 
+    // Separate the option flags from the positional arguments
+    search_options options;
+    argc = ParseSearchOptions(argc, argv, options);
+
     // Check command line arguments for errors
-    if (argc != 4)
+    if (argc != 4 && argc != 5)
     {
-        cout << "Usage: ./greedy <random number seed> <dimensions> <number of random variables>" << endl;
+        cout << "Usage: ./sa <random number seed> <dimensions> <number of random variables> [replicas (0 = one per core)] [-q | -e <k>] [-t <trace file>] [-l <landscape file>]" << endl;
         return 1;
     }
 
+    // The trajectory is written with '\n' rather than endl, so let cout
+    // buffer freely instead of synchronizing with stdio
+    ios_base::sync_with_stdio(false);
+
     // Read command line arguments into variables
     dimens = atoi(argv[2]);
     summands = atoi(argv[3]);
 
-    // Seed random number generator with command line argument
-    srand(atoi(argv[1]));
+    // Seed the landscape and the search with separate streams of the
+    // command line argument, so the search starts from the same points
+    // whether the landscape is generated or loaded from a file
+    xoshiro256 landscape_rng(atoi(argv[1]));
+    xoshiro256 rng = xoshiro256::Stream(atoi(argv[1]), 1);
+
+    // Compute a sum of Gaussians, or load a saved one whose size must
+    // match the one given so the arguments still describe the search
+    SumofGaussians* landscape = options.landscape_path.empty()
+                                ? new SumofGaussians(dimens, summands, landscape_rng)
+                                : new SumofGaussians(options.landscape_path.c_str());
+    if (!options.landscape_path.empty() && (landscape->dimensions() != dimens || landscape->count() != summands))
+    {
+        cout << "Unable to load a landscape of " << summands << " centers in " << dimens
+             << " dimensions from: " << options.landscape_path << endl;
+        delete landscape;
+        return 1;
+    }
+    SumofGaussians& sum_func = *landscape;
 
-    // Compute a sum of Gaussians
-    SumofGaussians sum_func(dimens, summands);
+    // Variable to store preimage
+    double preimage[dimens];
 
-    // Variables to store preimage and gradient of preimage
-    double preimage[dimens], grad[dimens];
+    trace_writer trace;
+    if (!options.trace_path.empty() && !trace.Open(options.trace_path, dimens))
+    {
+        cout << "Unable to open trace file: " << options.trace_path << endl;
+        delete landscape;
+        return 1;
+    }
 
-    // Compute randomized starting point
-    for(int i = 0; i < dimens; ++i)
+    // If a replica count was given, use replica exchange instead of
+    // a single annealing chain
+    if (argc == 5)
     {
-        // Generate random components on interval [0,10]
-        preimage[i] = ((1.0*rand())/RAND_MAX)*10.0;
+        int replicas = atoi(argv[4]);
+        if (replicas < 1)
+            replicas = (thread::hardware_concurrency() > 0) ? thread::hardware_concurrency() : 1;
+
+        double best_val = ParallelTempering(sum_func, dimens, replicas, rng, preimage, options, trace);
+
+        // Print the final results
+        for(int l = 0; l < dimens; ++l)
+            cout << preimage[l] << " ";
+        cout << best_val << endl;
+
+        delete landscape;
+        return 0;
     }
 
+    // Compute randomized starting point with components on interval [0,10]
+    rng.Uniform(preimage, dimens, 0.0, 10.0);
+
     // Perform simulated annealing to find maximum
-    for(int i = 1; i < 7501; ++i)
+    simulated_annealing annealer(sum_func, dimens, rng, STEP_SIZE, SA_STEPS);
+    annealer.Start(preimage);
+    while(!annealer.Done())
     {
-        // Variables to store some terms to speed up computation
-        double curr_val, next_val;
+        unsigned long i = annealer.Steps() + 1;
 
-        // Compute the Laplacian of the sum at the current preimage
-        // to get a measurement of "coolness" and proximity to
-        // points which are relatively more "warm"
-        double coolness = 0.0;
+        // Print the current value
+        if (ShouldPrint(options, i))
+            cout << annealer.Value() << '\n';
 
-        // Compute gradient
-        sum_func.deriv(preimage, grad);
+        if (trace.IsOpen())
+            trace.Record(i, annealer.Value(), annealer.Preimage());
 
-        // Compute current function value
-        curr_val = sum_func.eval(preimage);
+        annealer.Step();
+    }
+ 
+    // Print the best results found
+    for(int l = 0; l < dimens; ++l)
+        cout << annealer.BestPoint()[l] << " ";
+    cout << annealer.BestValue() << endl;
 
-        // Approximate the second dervatives using gradient
-        // and sum them up into the divergence
-        for(int x = 0; x < dimens; ++x)
-        {
-            double forward[dimens];
-        
-            for(int y = 0; y < dimens; ++y)
-            {
-                // Only apply the forward step in one direction to take
-                // second partial derivative in that direction
-                if (x == y)    forward[y] = preimage[y] + STEP_SIZE;
-                else           forward[y] = preimage[y];
-            }
+    if (trace.IsOpen())
+        trace.Record(SA_STEPS + 1, annealer.BestValue(), annealer.BestPoint());
+
+    delete landscape;
+    return 0;
+}
+
+// ParallelTempering: Runs a number of Metropolis chains at geometrically
+// spaced temperatures across all available cores, periodically attempting
+// to exchange states between neighboring temperatures. Returns the best
+// value found and stores its preimage in best_point. Each chain draws from
+// its own stream jumped ahead of rng, which makes exchange decisions.
+double ParallelTempering(const SumofGaussians& gauss_sum, int dimensions, int replicas, xoshiro256& rng, double best_point[],
+                         const search_options& options, trace_writer& trace)
+{
+    vector<Replica> chains(replicas);
+    BestSoFar best;
+    best.value = -1.0;
+
+    // Chain streams are successive jumps of the main stream
+    xoshiro256 stream = rng;
+
+    // Build the temperature ladder and give each chain a random start
+    for(int r = 0; r < replicas; ++r)
+    {
+        Replica& chain = chains[r];
+
+        // Geometric spacing keeps the exchange acceptance rate roughly
+        // uniform along the ladder
+        double fraction = (replicas > 1) ? double(r)/(replicas - 1) : 0.0;
+        chain.temperature = PT_T_MIN * pow(PT_T_MAX/PT_T_MIN, fraction);
+
+        // Hot chains take large steps to cross between basins while cold
+        // chains take small steps to refine the peak they sit on
+        chain.step = STEP_SIZE * sqrt(chain.temperature/PT_T_MIN);
+
+        stream.Jump();
+        chain.engine = stream;
 
-            coolness += sum_func.eval(forward) - curr_val + STEP_SIZE*grad[x];
+        chain.preimage.resize(dimensions);
+        chain.engine.Uniform(chain.preimage.data(), dimensions, 0.0, 10.0);
+        chain.value = gauss_sum.eval(chain.preimage.data());
+
+        if(chain.value > best.value)
+        {
+            best.value = chain.value;
+            best.preimage = chain.preimage;
         }
+    }
+
+    // Never start more threads than there are replicas or cores
+    int threads = thread::hardware_concurrency();
+    if(threads < 1)          threads = 1;
+    if(threads > replicas)   threads = replicas;
+
+    // Start the workers once, each waiting on the gate for every epoch
+    EpochGate gate;
+    vector<thread> workers;
+    for(int t = 1; t < threads; ++t)
+        workers.emplace_back(TemperReplicas, cref(gauss_sum), ref(chains), t, threads, ref(best), ref(gate));
 
-        // Multiply sum by reciporical of STEP_SIZE squared and 2 to finish
-        // divergence approximation
-        // coolness = (2*coolness);
-        coolness = (2*coolness)*(INV_STEP*INV_STEP);
-		
-		//coolness = Laplacian(grad,dimens,sum_func);
-
-        // Compute temperature using coolness
-        //double temperature = ANNEAL/(i*(1.0 + ((coolness > 0.0) ? coolness : 0.0)));
-        double temperature = (ANNEAL - i)/((coolness > 0.0) ? coolness : 1.0);
-
-        // Print the current preimage
-        //for(int j = 0; j < dimens; ++j)
-        //{   cout << preimage[j] << " ";   }
-        cout << curr_val << endl;
-
-        // Choose random next step around preimage
-        double next_preimage[dimens];
-        for(int j = 0; j < dimens; ++j)
+    for(int epoch = 0; epoch < PT_STEPS/SWAP_INTERVAL; ++epoch)
+    {
+        // Advance all chains independently, one strided group per thread
         {
-            // Let next_preimage be preimage with each component preturbed by
-            // some random float value in the interval [-0.1,0.1]
-            next_preimage[j] = preimage[j] + ((STEP_SIZE*rand())/(RAND_MAX))*((rand()%2 == 0)? 1.0 : -1.0);
+            lock_guard<mutex> guard(gate.lock);
+            gate.pending = threads - 1;
+            ++gate.epoch;
         }
+        gate.start.notify_all();
 
-        // Determine whether the next preimage should be used following
-        // the metropolis criterion
-        bool move = false;
-        next_val = sum_func.eval(next_preimage);
-        if(next_val > curr_val)
-            move = true;
+        AdvanceReplicas(gauss_sum, chains, 0, threads, best);
 
-        else
         {
-            if(double(rand())/double(RAND_MAX) < (next_val - curr_val)/temperature)
-                move = true;
+            unique_lock<mutex> waiting(gate.lock);
+            gate.done.wait(waiting, [&]{ return gate.pending == 0; });
         }
 
-        // If the move was chosen
-        if(move)
+        // Attempt exchanges between neighbors, alternating between even
+        // and odd pairs so every pair is tried every other epoch
+        for(int r = epoch % 2; r + 1 < replicas; r += 2)
         {
-            // Set the preimage equal to the new preimage
-            for(int k = 0; k < dimens; ++k)
+            Replica& cold = chains[r];
+            Replica& hot = chains[r + 1];
+
+            // Accept with probability exp((f_hot - f_cold)(1/T_cold - 1/T_hot))
+            double log_accept = (hot.value - cold.value)*(1.0/cold.temperature - 1.0/hot.temperature);
+            if(log_accept >= 0.0 || rng.Uniform() < exp(log_accept))
             {
-                preimage[k] = next_preimage[k];
+                swap(cold.preimage, hot.preimage);
+                swap(cold.value, hot.value);
             }
         }
 
+        // Report the best value found so far once per exchange round
+        if (ShouldPrint(options, epoch))
+            cout << best.value << '\n';
+
+        if (trace.IsOpen())
+            trace.Record(epoch, best.value, best.preimage.data());
     }
- 
-    // Print the final results
-    for(int l = 0; l < dimens; ++l)
-        cout << preimage[l] << " ";
-    cout << sum_func.eval(preimage) << endl;
 
-    return 0;
-}
+    // Release and join the workers
+    {
+        lock_guard<mutex> guard(gate.lock);
+        gate.stopping = true;
+    }
+    gate.start.notify_all();
+    for(thread& worker : workers)
+        worker.join();
 
-// Laplacian: Computes the Laplacian ( divergence of the gradient )
-// of a vector along the sum of Gaussians function using forward
-// difference approximation
-double Laplacian(double vector[], int dimensions, SumofGaussians gauss_sum)
-{
-    // Contains divergence of gradient
-    double divergence = 0.0;
-    double grad[dimensions];
+    for(int i = 0; i < dimensions; ++i)
+        best_point[i] = best.preimage[i];
 
-    // Compute gradient
-    gauss_sum.deriv(vector, grad);
+    return best.value;
+}
 
-    // Approximate the second dervatives using gradient
-    // and sum them up into the divergence
-    for(int i = 0; i < dimensions; ++i)
+// AdvanceReplicas: Advances every stride-th replica starting at first by
+// SWAP_INTERVAL Metropolis steps and records any improvement in best.
+void AdvanceReplicas(const SumofGaussians& gauss_sum, vector<Replica>& chains, int first, int stride, BestSoFar& best)
+{
+    for(int r = first; r < int(chains.size()); r += stride)
     {
-        double forward[dimensions];
-        
-        for(int j = 0; j < dimensions; ++j)
+        Replica& chain = chains[r];
+        int dimensions = chain.preimage.size();
+        vector<double> next_preimage(dimensions);
+        vector<double> local_best;
+        double local_best_val = chain.value;
+
+        for(int i = 0; i < SWAP_INTERVAL; ++i)
         {
-            // Only apply the forward step in one direction to take
-            // second partial derivative in that direction
-            if (i == j)    forward[j] = vector[j] + STEP_SIZE;
-            else           forward[j] = vector[j];
+            // Perturb each component uniformly within the chain's step
+            chain.engine.Uniform(next_preimage.data(), dimensions, -chain.step, chain.step);
+            for(int j = 0; j < dimensions; ++j)
+                next_preimage[j] += chain.preimage[j];
+
+            // Metropolis criterion for maximization
+            double next_val = gauss_sum.eval(next_preimage.data());
+            if(next_val >= chain.value || chain.engine.Uniform() < exp((next_val - chain.value)/chain.temperature))
+            {
+                swap(chain.preimage, next_preimage);
+                chain.value = next_val;
+
+                if(chain.value > local_best_val)
+                {
+                    local_best_val = chain.value;
+                    local_best = chain.preimage;
+                }
+            }
         }
 
-        divergence += gauss_sum.eval(forward) - gauss_sum.eval(vector) - STEP_SIZE*grad[i];
+        // Only take the lock once per batch, and only on improvement
+        if(!local_best.empty())
+        {
+            lock_guard<mutex> guard(best.lock);
+            if(local_best_val > best.value)
+            {
+                best.value = local_best_val;
+                best.preimage = local_best;
+            }
+        }
     }
+}
 
-    // Multiply sum by reciporical of STEP_SIZE squared and 2 to finish
-    // divergence approximation
-    divergence = 2*divergence*(INV_STEP*INV_STEP);
+// TemperReplicas: Body of each tempering worker, which advances its
+// replicas once per epoch opened by gate until the run is over
+void TemperReplicas(const SumofGaussians& gauss_sum, vector<Replica>& chains, int first, int stride, BestSoFar& best,
+                    EpochGate& gate)
+{
+    unsigned long seen = 0;
+    while(true)
+    {
+        {
+            unique_lock<mutex> waiting(gate.lock);
+            gate.start.wait(waiting, [&]{ return gate.stopping || gate.epoch != seen; });
+            if(gate.stopping)
+                return;
+            seen = gate.epoch;
+        }
 
-    return divergence;
+        AdvanceReplicas(gauss_sum, chains, first, stride, best);
 
+        bool last;
+        {
+            lock_guard<mutex> guard(gate.lock);
+            last = (--gate.pending == 0);
+        }
+        if(last)
+            gate.done.notify_one();
+    }
 }
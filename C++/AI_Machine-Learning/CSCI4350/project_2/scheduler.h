@@ -0,0 +1,306 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: scheduler.h
+ *    File Description: Header file containing resumable search
+ *    tasks, which wrap the ascent engines and simulated annealing
+ *    behind one step-at-a-time interface, and a successive halving
+ *    scheduler which interleaves many tasks on a few threads and
+ *    keeps stepping only the most promising of them.
+ *
+ */
+
+#ifndef SEARCH_SCHEDULER
+#define SEARCH_SCHEDULER
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "SumofGaussians.h"
+#include "rng.h"
+#include "ascent_optimizers.h"
+#include "annealing.h"
+
+// search_task: A single search from one starting point which can be
+// advanced a step at a time, paused and resumed later, or abandoned.
+// Tasks share nothing, so different tasks may be stepped on different
+// threads at once.
+class search_task
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        virtual ~search_task() {}
+
+        // Step: Advances the search by one step. Returns false without
+        // moving once the search has finished.
+        virtual bool Step() = 0;
+
+        // Finished: True once Step can no longer move the search
+        virtual bool Finished() const = 0;
+
+        // Point and Value: Best point of the search so far and its value
+        virtual const double* Point() const = 0;
+        virtual double Value() = 0;
+
+        // Steps: Steps taken so far, Evaluations: their cost in evaluations
+        virtual unsigned long Steps() const = 0;
+        virtual unsigned long Evaluations() const = 0;
+
+};
+
+// ascent_task: A climb by one of the gradient ascent engines, which is
+// finished once converged or after max_steps iterations
+class ascent_task : public search_task
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // ascent_task constructor: Takes ownership of the engine and
+        // starts its climb at the given preimage
+        ascent_task(ascent_optimizer* engine, const SumofGaussians& function, const double start[], unsigned long max_steps)
+            : climber(engine), func(function), limit(max_steps)
+        {
+            climber->Start(start);
+            valued_at = ~0UL;
+            value_evaluations = 0;
+            value = 0.0;
+            return;
+        }
+
+        ~ascent_task() { delete climber; }
+
+        bool Step()
+        {
+            if(Finished())
+                return false;
+            return climber->Step();
+        }
+
+        bool Finished() const
+        {
+            return climber->Converged() || climber->Iterations() >= limit;
+        }
+
+        const double* Point() const { return climber->Preimage(); }
+
+        // Value: The engines only need gradients, so the value is evaluated
+        // here, once per iteration at which it is asked for
+        double Value()
+        {
+            if(valued_at != climber->Iterations())
+            {
+                value = func.eval(climber->Preimage());
+                valued_at = climber->Iterations();
+                ++value_evaluations;
+            }
+            return value;
+        }
+
+        unsigned long Steps() const { return climber->Iterations(); }
+
+        unsigned long Evaluations() const
+        {
+            return climber->Evaluations() + climber->GradientEvaluations() + value_evaluations;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        ascent_optimizer* climber;          // Engine performing the climb
+        const SumofGaussians& func;         // Function being climbed
+        unsigned long limit;                // Iterations after which the climb is abandoned
+        unsigned long valued_at;            // Iteration at which value was computed
+        unsigned long value_evaluations;    // Evaluations spent on Value
+        double value;                       // Value at that iteration
+
+};
+
+// annealing_task: One simulated annealing run with its own random stream
+class annealing_task : public search_task
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // annealing_task constructor: Starts a run of the given length at
+        // the given preimage, drawing from the given stream
+        annealing_task(const SumofGaussians& function, int dimensions, const xoshiro256& stream, const double start[],
+                       double step_size, unsigned long steps)
+            : engine(stream), annealer(function, dimensions, engine, step_size, steps)
+        {
+            annealer.Start(start);
+            return;
+        }
+
+        bool Step()                         { return annealer.Step(); }
+        bool Finished() const               { return annealer.Done(); }
+        const double* Point() const         { return annealer.BestPoint(); }
+        double Value()                      { return annealer.BestValue(); }
+        unsigned long Steps() const         { return annealer.Steps(); }
+        unsigned long Evaluations() const   { return annealer.Evaluations(); }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        xoshiro256 engine;                  // Private stream of the run, declared before annealer
+        simulated_annealing annealer;       // The run itself
+
+};
+
+// MakeTask: Creates a task of the named search ("sa" or any engine known to
+// MakeOptimizer) starting at the given preimage, or returns nullptr if no
+// search has that name. The caller owns the result.
+inline search_task* MakeTask(const std::string& name, const SumofGaussians& function, int dimensions,
+                             const xoshiro256& stream, const double start[], double tolerance, double step_size,
+                             unsigned long max_steps)
+{
+    if(name == "sa")
+        return new annealing_task(function, dimensions, stream, start, step_size, max_steps);
+
+    ascent_optimizer* climber = MakeOptimizer(name, function, dimensions, tolerance, step_size);
+    if(climber == nullptr)
+        return nullptr;
+    return new ascent_task(climber, function, start, max_steps);
+}
+
+// successive_halving: Races a set of tasks. Every rung brings each
+// surviving task up to the rung's step budget, then keeps only the best
+// 1/eta of them by value and multiplies the budget by eta. Once a single
+// task survives it is run to the end. The rungs are split between threads
+// a task at a time, so uneven tasks still keep every thread busy.
+class successive_halving
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // successive_halving constructor: Takes ownership of the tasks
+        successive_halving(const std::vector<search_task*>& searches, unsigned long first_budget, unsigned int reduction,
+                           unsigned int threads = 0)
+            : tasks(searches), survivors(searches)
+        {
+            budget = (first_budget > 0) ? first_budget : 1;
+            eta = (reduction > 1) ? reduction : 2;
+
+            if(threads == 0)
+                threads = std::thread::hardware_concurrency();
+            thread_count = (threads > 0) ? threads : 1;
+
+            rungs = 0;
+            return;
+        }
+
+        ~successive_halving()
+        {
+            for(search_task* task : tasks)
+                delete task;
+            return;
+        }
+
+        // Rung: Runs the next rung. Returns false once the race is over,
+        // that is once the last survivor has finished.
+        bool Rung()
+        {
+            if(Done())
+                return false;
+
+            // The last survivor is not raced against anything, so it runs
+            // to the end rather than to a budget
+            unsigned long target = (survivors.size() == 1) ? ~0UL : budget;
+            Advance(target);
+            ++rungs;
+
+            // Keep the best 1/eta by value, at least one
+            std::stable_sort(survivors.begin(), survivors.end(),
+                             [](search_task* a, search_task* b) { return a->Value() > b->Value(); });
+            size_t keep = std::max<size_t>(1, survivors.size()/eta);
+            survivors.resize(keep);
+
+            budget *= eta;
+            return true;
+        }
+
+        // Done: True once a single survivor remains and it has finished
+        bool Done() const
+        {
+            return survivors.size() == 1 && survivors[0]->Finished();
+        }
+
+        // Best: The leading survivor, valid after at least one rung
+        search_task& Best() const { return *survivors[0]; }
+
+        // Survivors: Tasks still in the race, best first after each rung
+        size_t Survivors() const { return survivors.size(); }
+
+        // Budget: Step budget of the next rung
+        unsigned long Budget() const { return budget; }
+
+        // Rungs: Number of rungs run so far
+        unsigned int Rungs() const { return rungs; }
+
+        // Evaluations: Evaluations spent by every task, abandoned or not
+        unsigned long Evaluations() const
+        {
+            unsigned long total = 0;
+            for(const search_task* task : tasks)
+                total += task->Evaluations();
+            return total;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        std::vector<search_task*> tasks;        // Every task, owned
+        std::vector<search_task*> survivors;    // Tasks still in the race
+        unsigned long budget;                   // Steps each survivor is brought up to next rung
+        unsigned int eta;                       // Reduction factor between rungs
+        unsigned int thread_count;              // Threads sharing each rung
+        unsigned int rungs;                     // Rungs run so far
+
+        // Advance: Steps every survivor until it has taken target steps or
+        // finished. Threads claim survivors one at a time from a counter.
+        void Advance(unsigned long target)
+        {
+            std::atomic<size_t> next(0);
+            auto work = [&]()
+            {
+                for(size_t i = next++; i < survivors.size(); i = next++)
+                {
+                    search_task* task = survivors[i];
+                    while(task->Steps() < target && task->Step())
+                        ;
+
+                    // Value may evaluate the function, so do it here in parallel
+                    task->Value();
+                }
+            };
+
+            unsigned int threads = std::min<size_t>(thread_count, survivors.size());
+            std::vector<std::thread> workers;
+            for(unsigned int t = 1; t < threads; ++t)
+                workers.emplace_back(work);
+            work();
+            for(std::thread& worker : workers)
+                worker.join();
+            return;
+        }
+
+};
+
+#endif
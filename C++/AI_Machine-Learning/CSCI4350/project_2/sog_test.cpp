@@ -7,6 +7,7 @@
 #include <cstdlib>
 
 #include "SumofGaussians.h"
+#include "rng.h"
 
 using namespace std;
 
@@ -16,8 +17,8 @@ int main(int argc, char* argv[]) {
   int dims = atoi(argv[2]);
   int ncenters = atoi(argv[3]);
   
-  srand(seed);
-  SumofGaussians sog(dims,ncenters);
+  xoshiro256 rng(seed);
+  SumofGaussians sog(dims,ncenters,rng);
 
   double input[dims];
   double dz[dims];
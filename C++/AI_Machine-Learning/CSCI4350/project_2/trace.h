@@ -0,0 +1,189 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: A Comparison of Local Search Strategies
+ *    File: trace.h
+ *    File Description: Header file containing the command line
+ *    options shared by the local search programs (how often to print
+ *    the trajectory, where to write a binary trace and which saved
+ *    landscape to search) along with a buffered writer for the
+ *    binary trace.
+ *
+ *    Binary trace format (host byte order):
+ *        header:  char[4] "SOGT", uint32 version, uint32 dimensions, uint32 reserved
+ *        records: uint64 step, double value, double point[dimensions]
+ *
+ */
+
+#ifndef SEARCH_TRACE
+#define SEARCH_TRACE
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define TRACE_VERSION 1
+
+// search_options: Which landscape the programs search and how much of
+// the search they report
+struct search_options
+{
+    unsigned long every;        // Print every this many steps, 0 prints only the final result
+    std::string trace_path;     // File receiving the binary trace, empty for none
+    std::string landscape_path; // Saved landscape to search instead of generating one
+    bool use_cache;             // Whether multistart shares a cache of known basins
+};
+
+// ParseSearchOptions: Removes the option flags from the command line and
+// stores them in options, returning the number of arguments left. The
+// default prints every step, matching the original programs.
+//     -q          print only the final result
+//     -e <k>      print every k-th step
+//     -t <file>   write every step (every start, for multistart) to a binary trace file
+//     -l <file>   search the landscape saved in file (see SumofGaussians::save)
+//     -n          run multistart without its basin cache
+inline int ParseSearchOptions(int argc, char** argv, search_options& options)
+{
+    options.every = 1;
+    options.trace_path.clear();
+    options.landscape_path.clear();
+    options.use_cache = true;
+
+    int kept = 1;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-q") == 0)
+            options.every = 0;
+        else if(strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+            options.every = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            options.trace_path = argv[++i];
+        else if(strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+            options.landscape_path = argv[++i];
+        else if(strcmp(argv[i], "-n") == 0)
+            options.use_cache = false;
+        else
+            argv[kept++] = argv[i];
+    }
+
+    return kept;
+}
+
+// ShouldPrint: Whether the given step is printed under the options
+inline bool ShouldPrint(const search_options& options, unsigned long step)
+{
+    return options.every != 0 && step % options.every == 0;
+}
+
+// trace_writer: Writes search steps to a compact binary file. Records are
+// gathered in a private buffer and written in large blocks, so tracing
+// every step costs a memcpy rather than a system call.
+class trace_writer
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        trace_writer() : file(nullptr), used(0), dims(0) {}
+
+        // trace_writer destructor: Flushes and closes any open trace
+        ~trace_writer()
+        {
+            Close();
+            return;
+        }
+
+        // Open: Creates the trace file and writes its header. Returns false
+        // if the file could not be created.
+        bool Open(const std::string& path, unsigned int dimensions, size_t buffer_bytes = 1 << 20)
+        {
+            Close();
+
+            file = fopen(path.c_str(), "wb");
+            if(file == nullptr)
+                return false;
+
+            dims = dimensions;
+            buffer.resize(buffer_bytes);
+            used = 0;
+
+            uint32_t header[3] = { TRACE_VERSION, dims, 0 };
+            Append("SOGT", 4);
+            Append(header, sizeof(header));
+            return true;
+        }
+
+        // IsOpen: Whether a trace is being written
+        bool IsOpen() const
+        {
+            return file != nullptr;
+        }
+
+        // Record: Appends one step of the search
+        void Record(uint64_t step, double value, const double point[])
+        {
+            Append(&step, sizeof(step));
+            Append(&value, sizeof(value));
+            Append(point, dims*sizeof(double));
+            return;
+        }
+
+        // Close: Writes out anything still buffered and closes the file
+        void Close()
+        {
+            if(file == nullptr)
+                return;
+
+            Flush();
+            fclose(file);
+            file = nullptr;
+            return;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        FILE* file;                  // Trace file, or nullptr when closed
+        std::vector<char> buffer;    // Bytes not yet written to the file
+        size_t used;                 // Number of bytes of buffer in use
+        unsigned int dims;           // Length of each recorded point
+
+        // Append: Copies bytes into the buffer, writing it out when full
+        void Append(const void* data, size_t bytes)
+        {
+            if(used + bytes > buffer.size())
+            {
+                Flush();
+
+                // Records larger than the whole buffer go straight to the file
+                if(bytes > buffer.size())
+                {
+                    fwrite(data, 1, bytes, file);
+                    return;
+                }
+            }
+
+            memcpy(buffer.data() + used, data, bytes);
+            used += bytes;
+            return;
+        }
+
+        // Flush: Writes the buffered bytes to the file
+        void Flush()
+        {
+            if(used > 0)
+                fwrite(buffer.data(), 1, used, file);
+            used = 0;
+            return;
+        }
+
+};
+
+#endif
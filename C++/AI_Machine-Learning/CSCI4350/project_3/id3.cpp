@@ -19,24 +19,34 @@
 #include <cassert>
 #include <vector>
 #include "id3_tree.h"
+#include "id3_forest.h"
 
 using namespace std;
 
 // Transpose function: Corrects a fatal error
-vector<vector<double>> transpose(vector<vector<double>> matrix);
+vector<vector<double>> transpose(const vector<vector<double>>& matrix);
 
 int main(int argc, char** argv)
 {
     // Check for correct number of arguments
-    if(argc != 4)
+    if(argc < 4 || argc > 7)
     {
-        cerr << "Usage: ./id3 <number of features> <training data file> <test data file>" << endl;
+        cerr << "Usage: ./id3 <number of features> <training data file> <test data file> [threads (0 = one per core)] [bins (0 = exact splits)] [trees (0 = one tree)]" << endl;
         return -1;
     }
 
     // Get number of predictors
     unsigned int predictors = atoi(argv[1]);
 
+    // Get number of threads building the tree
+    unsigned int threads = (argc > 4) ? atoi(argv[4]) : 0;
+
+    // Get number of bins each attribute is quantized into, if any
+    unsigned int bins = (argc > 5) ? atoi(argv[5]) : 0;
+
+    // Get number of trees voting in a random forest, if any
+    unsigned int tree_count = (argc > 6) ? atoi(argv[6]) : 0;
+
     // Open files
     ifstream train;
     train.open(argv[2]);
@@ -83,22 +93,32 @@ int main(int argc, char** argv)
         return -2;
     }
 
-    // Construct ID3 tree
+    // Construct ID3 tree, or a forest of them sharing the prepared training set
     data_matrix = transpose(data_matrix);
-    id3_tree classifier(data_matrix, class_vector);
+    id3_tree* classifier = nullptr;
+    id3_forest* forest = nullptr;
+    if(tree_count == 0)
+        classifier = new id3_tree(data_matrix, class_vector, threads, bins);
+    else
+    {
+        id3_dataset training_set(data_matrix, class_vector, bins, threads);
+        forest = new id3_forest(training_set, tree_count, 0, 0, threads);
+        cerr << "Out of bag error: " << forest->OutOfBagError() << endl;
+    }
     //cout << "Ready to classify" << endl;
 
     // Clear data to make room for test data
     data_matrix.clear();
     class_vector.clear();
 
-    // Collect test data
+    // Collect test data, storing the entries one after another
+    vector<double> test_data;
     while( test >> curr_item )
     {
         if(column == predictors)
         {
-            // Push entry to data matrix and push class description to class vector
-            data_matrix.push_back(entry);
+            // Append entry to test data and push class description to class vector
+            test_data.insert(test_data.end(), entry.begin(), entry.end());
             class_vector.push_back(int(curr_item));
             column = 0;
 
@@ -121,20 +141,29 @@ int main(int argc, char** argv)
         return -2;
     }
 
-    // Use ID3 tree on training data
+    // Use ID3 tree on test data, classifying every entry at once
+    vector<int> results(class_vector.size());
+    if(classifier != nullptr)
+        classifier->Classify(test_data.data(), class_vector.size(), results.data());
+    else
+        forest->Classify(test_data.data(), class_vector.size(), results.data());
+
     unsigned int test_correct = 0;
     for(int i = 0; i < class_vector.size(); ++i)
     {
-        if( classifier.Classify(data_matrix[i]) == class_vector[i] ) ++test_correct;
+        if( results[i] == class_vector[i] ) ++test_correct;
     }
 
     cout << test_correct << endl;
+
+    delete classifier;
+    delete forest;
 	
     return 0;
 
 }
 
-vector<vector<double>> transpose(vector<vector<double>> matrix)
+vector<vector<double>> transpose(const vector<vector<double>>& matrix)
 {
     vector<vector<double>> new_matrix;
 
@@ -0,0 +1,197 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: The ID3 Algorithms for Supervised Learning
+ *    File: id3_dataset.h
+ *    File Description: Header file containing the definition
+ *    of a class which holds a continuous training data set prepared
+ *    once for building any number of ID3 decision trees from it,
+ *    laid out by attribute, sorted by each attribute and, if asked,
+ *    quantized into bins.
+ *
+ */
+
+#ifndef ID3DATASET
+#define ID3DATASET
+
+#include <algorithm>
+#include <vector>
+#include <numeric>
+#include <atomic>
+
+#include "task_pool.h"
+
+#define MAX_BINS 256    // Most bins an attribute is quantized into when splitting between bins
+
+// id3_dataset: A training set which trees are generated from. It is never
+// modified once created, so any number of trees may share it at once.
+class id3_dataset
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // id3_dataset constructor: Takes a training set (assumed complete),
+        // arranged with the rows representing the attributes, with the
+        // classification of each object. Given a number of bins (at most
+        // MAX_BINS), each attribute is also quantized into that many bins of
+        // about equal size so that splits are only sought between bins. The
+        // attributes are sorted by the given number of threads (0 for one per core).
+        id3_dataset(const std::vector<std::vector<double>>& data_matrix, const std::vector<int>& classifications,
+                    unsigned int bin_limit = 0, unsigned int threads = 1)
+        {
+            predictors = data_matrix.size();
+            size = classifications.size();
+
+            // Create vector of possible attribute values
+            for(int i = 0; i < classifications.size(); ++i)
+            {
+                // If the category value is new, then add it to the list of category values
+                if(std::find(category_values.begin(), category_values.end(), classifications[i]) == category_values.end())
+                    category_values.push_back(classifications[i]);
+            }
+
+            // Number each object's class by its place in category_values
+            categories.resize(size);
+            for(unsigned int t = 0; t < size; ++t)
+                categories[t] = std::find(category_values.begin(), category_values.end(), classifications[t]) - category_values.begin();
+
+            binned = (bin_limit != 0);
+            if(binned)
+            {
+                bin_limit = std::min(std::max(bin_limit, 2u), (unsigned int)MAX_BINS);
+                codes.resize(predictors*size_t(size));
+                cuts.resize(predictors*MAX_BINS);
+                bins.resize(predictors);
+            }
+            values.resize(predictors*size_t(size));
+            order.resize(predictors*size_t(size));
+
+            if(threads == 1)
+                SortAttributes(data_matrix, bin_limit, nullptr);
+            else
+            {
+                task_pool pool(threads);
+                SortAttributes(data_matrix, bin_limit, &pool);
+            }
+
+            // Lay out the histograms, after which the objects need no order
+            if(binned)
+            {
+                offsets.resize(predictors);
+                histogram_size = 0;
+                for(unsigned int a = 0; a < predictors; ++a)
+                {
+                    offsets[a] = histogram_size;
+                    histogram_size += bins[a]*category_values.size();
+                }
+
+                std::vector<int>().swap(order);
+            }
+            return;
+        }
+
+        // Size: Number of objects
+        unsigned int Size() const { return size; }
+
+        // Predictors: Number of attributes of each object
+        unsigned int Predictors() const { return predictors; }
+
+        // Categories: Classes into which the objects are classified
+        const std::vector<int>& Categories() const { return category_values; }
+
+        // Category: Index in Categories of the class of object t
+        int Category(unsigned int t) const { return categories[t]; }
+
+        // Object: Values of object t, attribute a at Object(t)[a*Size()]
+        const double* Object(unsigned int t) const { return &values[t]; }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        // Trees read the data directly while they are generated
+        friend class id3_tree;
+
+        unsigned int size;                // Number of objects
+        unsigned int predictors;          // Number of attributes of each object
+        std::vector<int> category_values; // Classes into which objects can be classified
+        std::vector<double> values;       // Value of attribute a of object t at values[a*size + t]
+        std::vector<int> categories;      // Index in category_values of each object's class
+        std::vector<int> order;           // Objects sorted by attribute a at order[a*size ...], unless binned
+
+        bool binned;                      // Whether splits are only sought between bins
+        std::vector<unsigned char> codes; // Bin of attribute a of object t at codes[a*size + t]
+        std::vector<double> cuts;         // Split point after bin b of attribute a at cuts[a*MAX_BINS + b]
+        std::vector<unsigned int> bins;   // Number of bins of each attribute
+        std::vector<unsigned int> offsets;// First count of each attribute in a histogram
+        unsigned int histogram_size;      // Counts in a histogram, one per category of every bin
+
+        // SortAttributes: Copies the training data into one contiguous block
+        // and sorts the objects by each attribute, which is done only once
+        // since the trees' nodes inherit the order from their parents, and
+        // then quantizes them into at most bin_limit bins if binned. The
+        // attributes are sorted at the same time if given a pool.
+        void SortAttributes(const std::vector<std::vector<double>>& data_matrix, unsigned int bin_limit, task_pool* pool)
+        {
+            std::atomic<int> pending(0);
+            for(unsigned int a = 0; a < predictors; ++a)
+            {
+                double* column = &values[a*size_t(size)];
+                int* sorted = &order[a*size_t(size)];
+                auto sort_attribute = [this, &data_matrix, a, column, sorted, bin_limit]()
+                {
+                    std::copy(data_matrix[a].begin(), data_matrix[a].begin() + size, column);
+                    std::iota(sorted, sorted + size, 0);
+                    std::sort(sorted, sorted + size, [column](int i, int j){ return column[i] < column[j]; });
+                    if(binned)
+                        Quantize(a, bin_limit);
+                };
+
+                if(pool != nullptr)
+                    pool->Spawn(sort_attribute, pending);
+                else
+                    sort_attribute();
+            }
+
+            if(pool != nullptr)
+                pool->Wait(pending);
+            return;
+        }
+
+        // Quantize: Places the objects into at most bin_limit bins by their value
+        // of attribute a, about equally many in each, without ever separating
+        // equal values. Splitting after a bin splits halfway to the next value.
+        void Quantize(unsigned int a, unsigned int bin_limit)
+        {
+            const double* column = &values[a*size_t(size)];
+            const int* sorted = &order[a*size_t(size)];
+            unsigned char* bin_codes = &codes[a*size_t(size)];
+            double* bin_cuts = &cuts[a*MAX_BINS];
+            unsigned int bin_size = (size + bin_limit - 1)/bin_limit;
+
+            unsigned int bin = 0, in_bin = 0;
+            for(unsigned int k = 0; k < size; ++k)
+            {
+                // Start the next bin once this one is full, at a gap between values
+                if( in_bin >= bin_size && bin + 1 < bin_limit && column[sorted[k - 1]] < column[sorted[k]] )
+                {
+                    bin_cuts[bin] = (column[sorted[k - 1]] + column[sorted[k]])/2.0;
+                    ++bin;
+                    in_bin = 0;
+                }
+
+                bin_codes[sorted[k]] = bin;
+                ++in_bin;
+            }
+
+            bins[a] = bin + 1;
+            return;
+        }
+
+};
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: The ID3 Algorithms for Supervised Learning
+ *    File: id3_forest.h
+ *    File Description: Header file containing the definition
+ *    of a class which builds a random forest of ID3 decision trees,
+ *    each from a bootstrap sample of one shared training set and
+ *    trying a random subset of the attributes at each node, and
+ *    classifies objects by the vote of its trees.
+ *
+ */
+
+#ifndef ID3FOREST
+#define ID3FOREST
+
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "task_pool.h"
+#include "id3_dataset.h"
+#include "id3_tree.h"
+
+#define VOTE_BLOCK 256    // Objects classified by every tree before moving on to the next ones
+
+// id3_forest: A bagged ensemble of ID3 trees generated from one training set
+class id3_forest
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // id3_forest constructor: Generates tree_count trees from the training
+        // set, each from as many objects drawn with replacement as it holds and
+        // trying "features" attributes at each node (0 for the square root of
+        // their number). The trees are generated by the given number of threads
+        // (0 for one per core), a tree to each, and are the same whatever their
+        // number for the same seed.
+        id3_forest(const id3_dataset& data, unsigned int tree_count, unsigned int features = 0, uint64_t seed = 0,
+                   unsigned int threads = 0)
+        {
+            predictors = data.Predictors();
+            category_values = data.Categories();
+            if( features == 0 )
+                features = std::max(1u, (unsigned int)std::lround(std::sqrt(double(predictors))));
+
+            unsigned int categories = category_values.size();
+            std::vector<unsigned int> oob_votes(data.Size()*size_t(categories), 0);
+
+            // Generate every tree, counting its votes on the objects it was not
+            // drawn from, category c of object t at oob_votes[t*categories + c]
+            trees.assign(tree_count, nullptr);
+            std::mutex vote_lock;
+            task_pool pool(threads);
+            std::atomic<int> pending(0);
+            for(unsigned int i = 0; i < tree_count; ++i)
+            {
+                pool.Spawn([this, &data, &vote_lock, &oob_votes, i, features, seed, categories]()
+                {
+                    // Draw the tree's bootstrap sample
+                    uint64_t state = seed ^ (uint64_t(i) << 32);
+                    std::vector<unsigned int> draws(data.Size(), 0);
+                    for(unsigned int k = 0; k < data.Size(); ++k)
+                        ++draws[id3_tree::Random(state) % data.Size()];
+
+                    id3_tree* tree = new id3_tree(data, draws, features, id3_tree::Random(state));
+                    trees[i] = tree;
+
+                    // Classify the objects left out of the sample
+                    std::vector<std::pair<unsigned int,int>> votes;
+                    for(unsigned int t = 0; t < data.Size(); ++t)
+                        if( draws[t] == 0 )
+                            votes.emplace_back(t, tree->Leaf(data.Object(t), data.Size()));
+
+                    std::lock_guard<std::mutex> guard(vote_lock);
+                    for(const std::pair<unsigned int,int>& vote : votes)
+                        ++oob_votes[vote.first*size_t(categories) + vote.second];
+                }, pending);
+            }
+            pool.Wait(pending);
+
+            // Score each object by the trees it was left out of
+            unsigned int voted = 0, wrong = 0;
+            for(unsigned int t = 0; t < data.Size(); ++t)
+            {
+                const unsigned int* votes = &oob_votes[t*size_t(categories)];
+                if( *std::max_element(votes, votes + categories) == 0 )
+                    continue;
+
+                ++voted;
+                if( int(std::max_element(votes, votes + categories) - votes) != data.Category(t) )
+                    ++wrong;
+            }
+            oob_error = (voted > 0) ? wrong/double(voted) : 0.0;
+            return;
+        }
+
+        // id3_forest destructor: Frees every tree
+        ~id3_forest()
+        {
+            for(id3_tree* tree : trees)
+                delete tree;
+            return;
+        }
+
+        // Trees: Number of trees in the forest
+        unsigned int Trees() const { return trees.size(); }
+
+        // OutOfBagError: Fraction of the training objects misclassified by the
+        // vote of the trees not drawn from them, among those left out of any tree
+        double OutOfBagError() const { return oob_error; }
+
+        // Classify: Classifies one object given as an array of "predictors" values
+        int Classify(const double data[]) const
+        {
+            int result;
+            Classify(data, 1, &result);
+            return result;
+        }
+
+        // Classify: Classifies count objects stored one after another in data,
+        // each as "predictors" values, writing their classes into classes. Each
+        // block of objects is walked down every tree before their votes are
+        // counted, so each tree's nodes are read for many objects at once.
+        // Ties go to the class seen first in the training set.
+        void Classify(const double data[], size_t count, int classes[]) const
+        {
+            unsigned int categories = category_values.size();
+            std::vector<int> leaves(VOTE_BLOCK);
+            std::vector<unsigned int> votes(VOTE_BLOCK*size_t(categories));
+            for(size_t first = 0; first < count; first += VOTE_BLOCK)
+            {
+                size_t block = std::min(count - first, size_t(VOTE_BLOCK));
+                std::fill(votes.begin(), votes.end(), 0);
+                for(const id3_tree* tree : trees)
+                {
+                    tree->Leaves(&data[first*predictors], block, leaves.data());
+                    for(size_t t = 0; t < block; ++t)
+                        ++votes[t*categories + leaves[t]];
+                }
+
+                for(size_t t = 0; t < block; ++t)
+                {
+                    const unsigned int* object_votes = &votes[t*categories];
+                    classes[first + t] = category_values[std::max_element(object_votes, object_votes + categories) - object_votes];
+                }
+            }
+            return;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        std::vector<id3_tree*> trees;     // Trees of the forest
+        std::vector<int> category_values; // Classes into which objects can be classified
+        unsigned int predictors;          // Number of predictors associated with each object
+        double oob_error;                 // Out of bag error of the forest
+
+};
+
+#endif
@@ -9,7 +9,8 @@
  *    File Description: Header file containing the definition
  *    of a class which takes in a continuous data set (arrange with the
  *    rows representing the attributes and the columns representing
- *    the data samples) and constructs an ID3 decision tree from the data.
+ *    the data samples) and constructs an ID3 decision tree from the data,
+ *    or from a sample of a training set shared with other trees.
  *
  */
 
@@ -21,22 +22,17 @@
 #include <numeric>
 #include <cmath>
 #include <iostream>
+#include <queue>
+#include <atomic>
+#include <cstdint>
 
-// Attribute sorting function provided by Dr. Phillips
-std::vector<std::vector<int> > sort_attributes(std::vector<std::vector<double> > data) 
-{
-  std::vector<std::vector<int> > indices;
-  std::vector<double> *ptr;
-  indices.resize(data.size());
-  for (int x = 0; x < indices.size(); x++) {
-    indices[x].resize(data[x].size());
-    std::iota(indices[x].begin(),indices[x].end(),0);
-    ptr = &(data[x]);
-    std::sort(indices[x].begin(),indices[x].end(),
-	 [&](size_t i, size_t j){ return (*ptr)[i] < (*ptr)[j]; });
-  }
-  return indices;
-}
+#include "task_pool.h"
+#include "id3_dataset.h"
+
+#define CLASSIFY_GROUP      8        // Objects walked down the tree together by the batch lookup
+#define SUBTREE_TASK_SIZE   2048     // Fewest objects in a subtree handed to another thread
+#define ATTRIBUTE_TASK_SIZE 16384    // Fewest objects in a node whose attributes are searched by several threads
+#define HISTOGRAM_NODE_SIZE 64       // Fewest objects in a node whose bins are counted in a histogram
 
 // id3_tree: A class representing the decision structure created from
 // a training data set which can be used as a classifier.
@@ -49,32 +45,69 @@ class id3_tree
 
         // id3_tree constructor: Takes a training set (assumed complete) with a
         // classification vector representing the classification for each
-        // corresponding row in the training data matrix.
-        id3_tree(std::vector<std::vector<double>> data_matrix, std::vector<int> classifications)
+        // corresponding row in the training data matrix. The tree is built by
+        // the given number of threads (0 for one per core), and is the same
+        // whatever their number. Given a number of bins (at most MAX_BINS),
+        // each attribute is first quantized into that many bins of about
+        // equal size, and splits are only sought between bins.
+        id3_tree(const std::vector<std::vector<double>>& data_matrix, const std::vector<int>& classifications,
+                 unsigned int threads = 1, unsigned int bins = 0)
         {
             //std::cout << "Generating Tree..." << std::endl;
 
-            // Number of predictors is the field count
-            if(!data_matrix.empty())
-                predictors = data_matrix.size();
-
-            // Create vector of possible attribute values
-            for(int i = 0; i < classifications.size(); ++i)
+            // Prepare the training set, which is only needed while the tree is
+            // built, and take its orderings over rather than copying them
+            id3_dataset data(data_matrix, classifications, bins, threads);
+            Sample sample;
+            sample.size = data.size;
+            sample.features = 0;
+            sample.seed = 0;
+            if(data.binned)
             {
-                // If the category value is new, then add it to the list of category values
-                if(std::find(category_values.begin(), category_values.end(), classifications[i]) == category_values.end())
-                    category_values.push_back(classifications[i]);
+                sample.order.resize(data.size);
+                std::iota(sample.order.begin(), sample.order.end(), 0);
             }
+            else
+                sample.order.swap(data.order);
 
-            // Recursively generate the ID3 tree
-            root = GenerateNode(data_matrix, classifications);
+            Build(data, sample, threads);
             //std::cout << "Tree successfully generated!" << std::endl;
             return;            
         }
+
+        // id3_tree constructor: Builds a tree from a sample of a shared training
+        // set, which holds object t draws[t] times. Each node tries only
+        // "features" attributes drawn at random from seed, or every attribute
+        // if it is 0. The tree is the same for any number of threads.
+        id3_tree(const id3_dataset& data, const std::vector<unsigned int>& draws, unsigned int features, uint64_t seed,
+                 unsigned int threads = 1)
+        {
+            Sample sample;
+            sample.size = std::accumulate(draws.begin(), draws.end(), 0u);
+            sample.features = (features < data.predictors) ? features : 0;
+            sample.seed = seed;
+            sample.order.reserve((data.binned ? 1 : data.predictors)*size_t(sample.size));
+
+            // List each object as often as it is drawn, keeping the drawn
+            // objects in order of each attribute without sorting them again
+            if(data.binned)
+            {
+                for(unsigned int t = 0; t < data.size; ++t)
+                    sample.order.insert(sample.order.end(), draws[t], t);
+            }
+            else
+            {
+                for(unsigned int k = 0; k < data.order.size(); ++k)
+                    sample.order.insert(sample.order.end(), draws[data.order[k]], data.order[k]);
+            }
+
+            Build(data, sample, threads);
+            return;
+        }
 		
         // Lookup: Takes a piece of data and attempts to classify the data
         // based on the information provided.
-        int Classify(std::vector<double> data)
+        int Classify(const std::vector<double>& data) const
         {
             // If the input data has more fields than the number of
             // predictors used to construct the tree, there is an error
@@ -84,18 +117,24 @@ class id3_tree
                 return -1;
             }
 		
-            // Return result of recursive lookup
-            return Classify(data, root);
+            // Return result of lookup
+            return Classify(data.data());
         }
 
-        // id3_tree desctructor: Cleans up memory allocated to constructing
-        // the id3_tree.
-        ~id3_tree()
+        // Classify: Classifies one object given as an array of "predictors" values
+        int Classify(const double data[]) const
         {
-            // Recursively destroy tree
-            Destroy(root);
+            return category_values[Leaf(data, 1)];
+        }
+
+        // Classify: Classifies count objects stored one after another in data,
+        // each as "predictors" values, writing their classes into classes
+        void Classify(const double data[], size_t count, int classes[]) const
+        {
+            Leaves(data, count, classes);
+            for(size_t t = 0; t < count; ++t)
+                classes[t] = category_values[classes[t]];
 
-            // Let other members be destroyed by their destructors
             return;
         }
 
@@ -103,239 +142,577 @@ class id3_tree
 
     private:
 
+        // Forests vote with the categories reached by their trees
+        friend class id3_forest;
+
         // Defines nodes for the id3_tree
         struct Node
         {
-            int attribute;           // Attribute label or, if the node is terminal, the class number 
+            int attribute;           // Attribute label or, if the node is terminal, the index of its class in category_values
             double split_point;      // Splitting point for continuously valued attributes
             Node* less;              // Class of all objects with attribute less than split
             Node* greater;           // Class of all objects with attributes greater than split
         };
+
+        // Defines the nodes of the finished tree, stored breadth first in one
+        // array so that the two children of a node are always adjacent
+        struct FlatNode
+        {
+            double split_point;      // Splitting point for continuously valued attributes
+            int attribute;           // Attribute label or, if the node is terminal, the index of its class
+            int less;                // Index of the less child, the greater child follows it (0 if terminal)
+        };
+
+        // Holds the objects a tree is generated from, drawn from a training set
+        // any number of times each. Each node owns the range [begin, end) of
+        // every attribute's ordering of the draws, which is split in place
+        // between its children. Splitting between bins needs no order, so
+        // then there is just the one list of draws.
+        struct Sample
+        {
+            unsigned int size;                // Number of draws
+            std::vector<int> order;           // Draws sorted by attribute a at order[a*size ...]
+            std::vector<char> is_less;        // Side of the current split each object falls on
+            std::vector<int> buffer;          // Holds the greater draws while an ordering is split
+            unsigned int features;            // Attributes tried at each node, or 0 for all of them
+            uint64_t seed;                    // Seed of the attributes drawn at each node
+        };
 		
 
-        Node* root;                  // Root node of tree
+        std::vector<FlatNode> nodes; // Nodes of tree, the root first
         std::vector<int> category_values; // Classes into which objects can be classified
         unsigned int predictors;     // Number of predictors associated with each entry in tree
 
+        // Build: Generates the tree from the sample with the given number of
+        // threads, then lays it out flat for lookups and discards the linked nodes
+        void Build(const id3_dataset& data, Sample& sample, unsigned int threads)
+        {
+            predictors = data.predictors;
+            category_values = data.category_values;
+            sample.is_less.resize(data.size);
+            sample.buffer.resize(sample.size);
+
+            // Recursively generate the ID3 tree
+            Node* root;
+            if(threads == 1)
+                root = GenerateNode(data, sample, 0, sample.size, RootHistogram(data, sample, nullptr), nullptr, nullptr);
+            else
+            {
+                // Every task spawned while building the tree is counted in
+                // pending, so the tree is whole once it reaches zero
+                task_pool pool(threads);
+                std::atomic<int> pending(0);
+                root = GenerateNode(data, sample, 0, sample.size, RootHistogram(data, sample, &pool), &pool, &pending);
+                pool.Wait(pending);
+            }
+
+            Flatten(root);
+            Destroy(root);
+            return;
+        }
+
+        // Leaf: Index of the class of the terminal node reached by the object
+        // whose value of attribute a is data[a*stride]
+        int Leaf(const double data[], size_t stride) const
+        {
+            // Descend until reaching a terminal node, whose attribute is the class
+            const FlatNode* node = &nodes[0];
+            while(node->less != 0)
+                node = &nodes[node->less + (data[node->attribute*stride] < node->split_point ? 0 : 1)];
+
+            return node->attribute;
+        }
+
+        // Leaves: Writes the index of the class of each of count objects stored
+        // one after another in data into leaves. Objects are walked down the
+        // tree in groups so that the lookups of one group overlap rather than
+        // waiting on each other.
+        void Leaves(const double data[], size_t count, int leaves[]) const
+        {
+            size_t group_end = count - count%CLASSIFY_GROUP;
+            for(size_t first = 0; first < group_end; first += CLASSIFY_GROUP)
+            {
+                // Every object of the group starts at the root
+                const double* objects = &data[first*predictors];
+                int current[CLASSIFY_GROUP] = {};
+
+                // Step each object still inside the tree down one level
+                bool descending = true;
+                while(descending)
+                {
+                    descending = false;
+                    for(int g = 0; g < CLASSIFY_GROUP; ++g)
+                    {
+                        const FlatNode& node = nodes[current[g]];
+                        if(node.less != 0)
+                        {
+                            current[g] = node.less + (objects[g*predictors + node.attribute] < node.split_point ? 0 : 1);
+                            descending = true;
+                        }
+                    }
+                }
+
+                for(int g = 0; g < CLASSIFY_GROUP; ++g)
+                    leaves[first + g] = nodes[current[g]].attribute;
+            }
+
+            // Classify the objects left over one at a time
+            for(size_t t = group_end; t < count; ++t)
+                leaves[t] = Leaf(&data[t*predictors], 1);
+
+            return;
+        }
+
+        // CountBins: Adds (or with a step of -1, removes) the objects in
+        // positions [begin, end) of sample.order to the counts of their bins
+        void CountBins(const id3_dataset& data, const Sample& sample, unsigned int begin, unsigned int end,
+                       std::vector<unsigned int>& histogram, int step, task_pool* pool) const
+        {
+            unsigned int categories = category_values.size();
+            ForEachAttribute(pool, end - begin, predictors, [&](unsigned int a)
+            {
+                const unsigned char* codes = &data.codes[a*size_t(data.size)];
+                unsigned int* counts = &histogram[data.offsets[a]];
+                for(unsigned int k = begin; k < end; ++k)
+                    counts[codes[sample.order[k]]*categories + data.categories[sample.order[k]]] += step;
+            });
+            return;
+        }
+
+        // RootHistogram: Counts the bins of every object when the root is
+        // large enough to have a histogram, or returns an empty one
+        std::vector<unsigned int> RootHistogram(const id3_dataset& data, const Sample& sample, task_pool* pool) const
+        {
+            std::vector<unsigned int> histogram;
+            if(data.binned && sample.size >= HISTOGRAM_NODE_SIZE)
+            {
+                histogram.assign(data.histogram_size, 0);
+                CountBins(data, sample, 0, sample.size, histogram, 1, pool);
+            }
+            return histogram;
+        }
+
+        // ForEachAttribute: Calls work with each of 0 to count - 1 in turn, or
+        // shares them between the threads of pool if given one and the node of
+        // size objects is large enough
+        template<typename Work>
+        void ForEachAttribute(task_pool* pool, unsigned int size, unsigned int count, const Work& work) const
+        {
+            if( pool == nullptr || size < ATTRIBUTE_TASK_SIZE )
+            {
+                for(unsigned int i = 0; i < count; ++i)
+                    work(i);
+                return;
+            }
+
+            std::atomic<int> pending(0);
+            for(unsigned int i = 1; i < count; ++i)
+                pool->Spawn([&work, i]() { work(i); }, pending);
+            work(0);
+            pool->Wait(pending);
+            return;
+        }
+
+        // NodeAttributes: Attributes tried at the node of draws [begin, end), in
+        // ascending order. Each node draws its own from the sample's seed and
+        // its range, so the tree does not depend on the order nodes are built in.
+        std::vector<unsigned int> NodeAttributes(const Sample& sample, unsigned int begin, unsigned int end) const
+        {
+            std::vector<unsigned int> attributes(predictors);
+            std::iota(attributes.begin(), attributes.end(), 0);
+            if( sample.features == 0 )
+                return attributes;
+
+            // Shuffle the first "features" attributes into place
+            uint64_t state = sample.seed ^ (uint64_t(begin) << 32 | end);
+            for(unsigned int j = 0; j < sample.features; ++j)
+                std::swap(attributes[j], attributes[j + Random(state) % (predictors - j)]);
+
+            attributes.resize(sample.features);
+            std::sort(attributes.begin(), attributes.end());
+            return attributes;
+        }
+
+        // Random: Next number of the splitmix64 sequence from state
+        static uint64_t Random(uint64_t& state)
+        {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
         // GenerateNode: Private function for generating nodes using the ID3 algorithm
-        // (field_count does not need to be passed to this function since all entries
-        //  in local_data are assumed to be the same length as "predictors" variable).
-        Node* GenerateNode(std::vector<std::vector<double>> local_data, std::vector<int> local_classes)
+        // from the draws in positions [begin, end) of the orderings of sample
+        // (field_count does not need to be passed to this function since every
+        //  object is assumed to have as many values as the "predictors" variable).
+        // When splitting between bins, histogram holds the counts of the node's
+        // bins if it is large enough to keep them, and is otherwise empty.
+        // Given a pool, large subtrees are left to it as tasks counted in pending,
+        // so the node is only complete once pending reaches zero.
+        Node* GenerateNode(const id3_dataset& data, Sample& sample, unsigned int begin, unsigned int end, std::vector<unsigned int> histogram,
+                           task_pool* pool, std::atomic<int>* pending)
         {
             // Create a new node to store node information 
             Node* new_node = new Node;
+            unsigned int size = end - begin;
 
             //std::cout << "Counting occurrences of each category..." << std::endl;
-            //std::cout << "Size of local data: " << local_data[0].size() << std::endl;
+            //std::cout << "Size of local data: " << size << std::endl;
             // Calculate the total number of objects in each category
-            std::vector<unsigned int> total_counts;
-            for( std::vector<int>::iterator category = category_values.begin(); category != category_values.end(); ++category )
-            {
-                unsigned int count = 0;
-
-                // Count number of occurences of a category value
-                for (std::vector<int>::iterator entry = local_classes.begin(); entry != local_classes.end(); ++entry )
-                    if( *category == *entry )
-                        ++count;
+            std::vector<unsigned int> total_counts(category_values.size(), 0);
+            for(unsigned int k = begin; k < end; ++k)
+                ++total_counts[data.categories[sample.order[k]]];
 
+            for(unsigned int c = 0; c < total_counts.size(); ++c)
+            {
                 // If all objects are of the same category, the data can be trivially classified
-                if ( count == local_classes.size() )
+                if ( total_counts[c] == size )
                 {
                     // Create terminal node of the category
-                    new_node->attribute = *category;
+                    new_node->attribute = c;
                     new_node->less = nullptr;
                     new_node->greater = nullptr;
 
                     // Return node
                     return new_node;
                 }
-
-                //std::cout << "Count of class " << *category << " is " << count << std::endl;
-
-                // Push probability to the vector
-                total_counts.push_back(count);
             }
 
             // Calculate the total information in the class divisions
             double total_information = 0.0;
             for(int i = 0; i < total_counts.size(); ++i)
-                if( total_counts[i]/double(local_data[0].size()) > 0 )
-                    total_information += -(total_counts[i]/double(local_data[0].size()))*log2(total_counts[i]/double(local_data[0].size()));
+                if( total_counts[i]/double(size) > 0 )
+                    total_information += -(total_counts[i]/double(size))*log2(total_counts[i]/double(size));
 
 
             //std::cout << "Total Information: " << total_information << std::endl;
 
-            //std::cout << "Sorting Attributes..." << std::endl;
-            // Sort the local data set with respect to each attribute and store
-            // the orderings in a new matrix
-            std::vector<std::vector<int>> sorted_index;
-            sorted_index = sort_attributes(local_data);
-
             //std::cout << "Finding maximal split..." << std::endl;
+            // Find the split point of maximal information gain of each attribute
+            // tried, sharing the attributes between threads when the node is large
+            std::vector<unsigned int> attributes = NodeAttributes(sample, begin, end);
+            std::vector<std::pair<double,double>> attribute_splits(attributes.size());
+            ForEachAttribute(pool, size, attributes.size(), [&](unsigned int j)
+            {
+                if(data.binned)
+                    attribute_splits[j] = FindBinnedSplit(data, sample, attributes[j], begin, end, total_counts, total_information,
+                                                          histogram.empty() ? nullptr : histogram.data());
+                else
+                    attribute_splits[j] = FindSplit(data, sample, attributes[j], begin, end, total_counts, total_information);
+            });
+
             // Find split point of maximal information gain initialized with
             // information gain equal to -1 to indicate no entry exists yet.
+            // Ties keep the earliest attribute, as each attribute's split does
+            // its smallest split point.
             std::pair<unsigned int,std::pair<double,double>> max_info_split;
             max_info_split.second.second = -1.0;
-            for(unsigned int i = 0; i < predictors; ++i)    // This loop iterates over attributes
+            for(unsigned int j = 0; j < attributes.size(); ++j)
+            {
+                if( max_info_split.second.second < attribute_splits[j].second )
+                {
+                    max_info_split.first = attributes[j];
+                    max_info_split.second = attribute_splits[j];
+                }
+            }
+
+            // If no attribute tried has two distinct values the objects cannot be
+            // told apart, so the node is terminal with the most common category.
+            // A split found may round to a gain just below zero, so only the
+            // initial -1 means none was found.
+            if( max_info_split.second.second == -1.0 )
             {
+                new_node->attribute = std::max_element(total_counts.begin(), total_counts.end()) - total_counts.begin();
+                new_node->less = nullptr;
+                new_node->greater = nullptr;
 
-                // Initialize a count of objects classified as less than a split point
-                std::vector<unsigned int> less_counts;
-                for(unsigned int c = 0; c < category_values.size(); ++c)
-                    less_counts.push_back(0);
+                return new_node;
+            }
 
-                // Find maximum information for each split point for the given attribute
-                double prev_val;
-                for(unsigned int k = 0; k < local_data[0].size(); ++k)    // Iterates through each element in a column
-                {
+            //std::cout << "Partitioning data about split..." << std::endl;
+            //std::cout << max_info_split.first << " " << max_info_split.second.first << " " << max_info_split.second.second << std::endl;
 
-                    // Cannot create split until first element has been parsed
-                    if( k == 0 )
-                    {
-                        prev_val = local_data[i][sorted_index[i][k]];
-                    }
+            // Mark which side of the split each object falls on, going by the
+            // bins rather than the values when splitting between bins
+            unsigned int less_size = 0;
+            if(data.binned)
+            {
+                const double* cuts = &data.cuts[max_info_split.first*MAX_BINS];
+                const unsigned char* split_codes = &data.codes[max_info_split.first*size_t(data.size)];
+                unsigned int split_bin = std::find(cuts, cuts + data.bins[max_info_split.first] - 1, max_info_split.second.first) - cuts;
+                for(unsigned int k = begin; k < end; ++k)
+                {
+                    sample.is_less[sample.order[k]] = split_codes[sample.order[k]] <= split_bin;
+                    less_size += sample.is_less[sample.order[k]];
+                }
+            }
+            else
+            {
+                const double* split_column = &data.values[max_info_split.first*size_t(data.size)];
+                for(unsigned int k = begin; k < end; ++k)
+                {
+                    sample.is_less[sample.order[k]] = split_column[sample.order[k]] < max_info_split.second.first;
+                    less_size += sample.is_less[sample.order[k]];
+                }
+            }
 
-                    // Check for a gap, if one exists compute the information
-                    else if( prev_val < local_data[i][sorted_index[i][k]] )
-                    {
-                        // Information expected from the 
-                        double exp_information = 0.0;
+            // Split each attribute's ordering in place, the lesser objects
+            // first, keeping both halves sorted without sorting them again
+            unsigned int orderings = data.binned ? 1 : predictors;
+            for(unsigned int attr = 0; attr < orderings; ++attr)
+            {
+                int* sorted = &sample.order[attr*size_t(sample.size) + begin];
+                int* greater = &sample.buffer[begin];
+                unsigned int less_end = 0, greater_end = 0;
+                for(unsigned int k = 0; k < size; ++k)
+                {
+                    if( sample.is_less[sorted[k]] )
+                        sorted[less_end++] = sorted[k];
+                    else
+                        greater[greater_end++] = sorted[k];
+                }
+                std::copy(greater, greater + greater_end, sorted + less_end);
+            }
 
-                        // Calculate the information using the counting data
-                        for(unsigned int m = 0; m < less_counts.size(); ++m)
-                        {
-                            //std::cout << local_data.size() << " " << total_counts[m] << std::endl;
-                            //std::cout << k << " " << less_counts[m] << std::endl;
-                            // p( less | class ) = less_counts[m]/double(k)
-                            // p( greater | class ) = double(total_counts[m] - less_counts[m])/(local_data[i].size() - k)
-                            // p( less ) = double(k)/local_data[i].size()
-                            // p( greater ) = double(local_data[i].size() - k)/local_data[i].size()
-                            //std::cout << double(less_counts[m])/double(k) << std::endl;
-                            if(double(less_counts[m])/double(k) > 0.0)
-                                exp_information -= double(k)/double(local_data[0].size()) * double(less_counts[m])/double(k) * log2(double(less_counts[m])/double(k));
-
-                            //std::cout << log2(double(total_counts[m] - less_counts[m])/double(local_data.size() - k)) << std::endl;
-                            if(double(total_counts[m] - less_counts[m])/double(local_data[0].size() - k) > 0.0)
-                                exp_information -= (double(local_data[0].size() - k)/double(local_data[0].size()))
-                                                    *(double(total_counts[m] - less_counts[m])/double(local_data[0].size() - k))
-                                                    *log2(double(total_counts[m] - less_counts[m])/double(local_data[0].size() - k));
-                        }
+            // Give the children large enough to keep one their histograms. Only
+            // the smaller child's objects are counted, and the larger child's
+            // histogram is what remains of this node's once they are removed.
+            std::vector<unsigned int> less_histogram, greater_histogram;
+            if( !histogram.empty() )
+            {
+                bool less_smaller = (less_size <= size - less_size);
+                unsigned int smaller_begin = less_smaller ? begin : begin + less_size;
+                unsigned int smaller_end = less_smaller ? begin + less_size : end;
+                std::vector<unsigned int>& smaller_histogram = less_smaller ? less_histogram : greater_histogram;
+                std::vector<unsigned int>& larger_histogram = less_smaller ? greater_histogram : less_histogram;
+
+                // Subtract the whole histogram if the smaller child keeps one,
+                // and otherwise just its objects
+                if( smaller_end - smaller_begin >= HISTOGRAM_NODE_SIZE )
+                {
+                    smaller_histogram.assign(data.histogram_size, 0);
+                    CountBins(data, sample, smaller_begin, smaller_end, smaller_histogram, 1, pool);
+                    for(unsigned int b = 0; b < data.histogram_size; ++b)
+                        histogram[b] -= smaller_histogram[b];
+                }
+                else
+                    CountBins(data, sample, smaller_begin, smaller_end, histogram, -1, pool);
 
-                        //std::cout << "Expected information: " << exp_information << std::endl;
+                if( size - (smaller_end - smaller_begin) >= HISTOGRAM_NODE_SIZE )
+                    larger_histogram.swap(histogram);
+                std::vector<unsigned int>().swap(histogram);
+            }
 
-                        // Replace the currently known best informaton split if need be
-                        if( (max_info_split.second.second < total_information - exp_information) ||
-                            ((max_info_split.second.second == total_information - exp_information) &&  
-                                (max_info_split.first > i || (max_info_split.first == i && max_info_split.second.first > (prev_val + local_data[i][sorted_index[i][k]])/2.0))) )
-                        {
-                            // Replace currently known best
-                            max_info_split.first = i;
-                            max_info_split.second.first = (prev_val + local_data[i][sorted_index[i][k]])/2.0;
-                            max_info_split.second.second = total_information - exp_information;
-                        }
+            // Assign split point
+            new_node->split_point = max_info_split.second.first;
 
-                    }
+            // Assign attribute
+            new_node->attribute = max_info_split.first;
 
-                    // Classify current piece of data and add it to the sum of lesser elements
-                    for(unsigned int categ = 0; categ < less_counts.size(); ++categ)
-                        if(category_values[categ] == local_classes[sorted_index[i][k]])
-                            ++less_counts[categ];
-                                
+            // Calculate greater node, leaving it to another thread if it is large
+            //std::cout << "Number of greater objects: " << size - less_size << std::endl;
+            if( pool != nullptr && size - less_size >= SUBTREE_TASK_SIZE )
+                pool->Spawn([=, &data, &sample, greater_histogram = std::move(greater_histogram)]() mutable
+                            { new_node->greater = GenerateNode(data, sample, begin + less_size, end, std::move(greater_histogram), pool, pending); },
+                            *pending);
+            else
+                new_node->greater = GenerateNode(data, sample, begin + less_size, end, std::move(greater_histogram), pool, pending);
 
-                    // Let the previous value be equal to the current value
-                    prev_val = local_data[i][sorted_index[i][k]];
+            // Calculate less node
+            //std::cout << "Number of lesser objects: " << less_size << std::endl;
+            new_node->less = GenerateNode(data, sample, begin, begin + less_size, std::move(less_histogram), pool, pending);
 
-                }
-                
-            }
+            // Return node
+            return new_node;
+        }
+	
+        // FindSplit: Finds the split point of maximal information gain on the
+        // given attribute for the draws in positions [begin, end) of the
+        // orderings of sample. Returns the split point and its gain, which is
+        // -1 if the attribute has no two distinct values to split between.
+        std::pair<double,double> FindSplit(const id3_dataset& data, const Sample& sample, unsigned int i, unsigned int begin, unsigned int end,
+                                           const std::vector<unsigned int>& total_counts, double total_information) const
+        {
+            unsigned int size = end - begin;
 
-            // Calculate lesser set and greater set
-            std::vector<std::vector<double>> less_data, greater_data;
-            std::vector<int> less_classes, greater_classes;
+            // The node's objects in order of this attribute, and their values
+            const int* sorted = &sample.order[i*size_t(sample.size) + begin];
+            const double* column = &data.values[i*size_t(data.size)];
 
-            //std::cout << "Partitioning data about split..." << std::endl;
-            //std::cout << max_info_split.first << " " << max_info_split.second.first << " " << max_info_split.second.second << std::endl;
+            // Initialize a count of objects classified as less than a split point
+            std::vector<unsigned int> less_counts(category_values.size(), 0);
 
-            std::vector<unsigned int> less_indices, greater_indices;
-            // Scan local_data and separate them into the lesser and greater data
-            for(unsigned int t = 0; t < local_data[0].size(); ++t)
+            // Find maximum information for each split point for the given attribute
+            // initialized with information gain equal to -1 to indicate no entry exists yet.
+            std::pair<double,double> max_info_split(0.0, -1.0);
+            double prev_val;
+            for(unsigned int k = 0; k < size; ++k)    // Iterates through each element in a column
             {
-                if( local_data[max_info_split.first][t] < max_info_split.second.first )
+
+                // Cannot create split until first element has been parsed
+                if( k == 0 )
                 {
-                    less_indices.push_back(t);
-                    less_classes.push_back(local_classes[t]);
+                    prev_val = column[sorted[k]];
                 }
 
-                else
+                // Check for a gap, if one exists compute the information
+                else if( prev_val < column[sorted[k]] )
                 {
-                    greater_indices.push_back(t);
-                    greater_classes.push_back(local_classes[t]);
+                    // Information expected from the 
+                    double exp_information = ExpectedInformation(less_counts, total_counts, k, size);
+
+                    //std::cout << "Expected information: " << exp_information << std::endl;
+
+                    // Replace the currently known best informaton split if need be,
+                    // which the later and so larger split points only do if better
+                    if( max_info_split.second < total_information - exp_information )
+                    {
+                        // Replace currently known best
+                        max_info_split.first = (prev_val + column[sorted[k]])/2.0;
+                        max_info_split.second = total_information - exp_information;
+                    }
+
                 }
+
+                // Classify current piece of data and add it to the sum of lesser elements
+                ++less_counts[data.categories[sorted[k]]];
+
+                // Let the previous value be equal to the current value
+                prev_val = column[sorted[k]];
+
             }
 
-            // For each attribute
-            for(unsigned int attr = 0; attr < local_data.size(); ++attr)
-            {
+            return max_info_split;
+        }
+
+        // FindBinnedSplit: Finds the split point between bins of maximal information
+        // gain on the given attribute for the draws in positions [begin, end) of
+        // sample.order, from the node's histogram if it has one. Returns the split
+        // point and its gain, which is -1 if the objects all share one bin.
+        std::pair<double,double> FindBinnedSplit(const id3_dataset& data, const Sample& sample, unsigned int i, unsigned int begin, unsigned int end,
+                                                 const std::vector<unsigned int>& total_counts, double total_information,
+                                                 const unsigned int* histogram) const
+        {
+            unsigned int size = end - begin;
+            unsigned int categories = category_values.size();
+            const unsigned char* codes = &data.codes[i*size_t(data.size)];
+            const double* cuts = &data.cuts[i*MAX_BINS];
 
-                std::vector<double> new_row;
+            // Initialize a count of objects classified as less than a split point
+            std::vector<unsigned int> less_counts(categories, 0);
+            std::pair<double,double> max_info_split(0.0, -1.0);
 
-                // Add lesser-indexed data to less sets
-                for(std::vector<unsigned int>::iterator lit = less_indices.begin(); lit < less_indices.end(); ++lit)
+            // With a histogram, try the split after each bin holding any objects
+            if(histogram != nullptr)
+            {
+                const unsigned int* counts = &histogram[data.offsets[i]];
+                unsigned int k = 0;
+                for(unsigned int b = 0; b + 1 < data.bins[i]; ++b)
                 {
-                    new_row.push_back(local_data[attr][*lit]);
+                    unsigned int in_bin = 0;
+                    for(unsigned int m = 0; m < categories; ++m)
+                    {
+                        less_counts[m] += counts[b*categories + m];
+                        in_bin += counts[b*categories + m];
+                    }
+                    k += in_bin;
+
+                    // Splits after empty bins are no different from the one before
+                    if( in_bin == 0 || k == size )
+                        continue;
+
+                    // Replace the currently known best informaton split if need be
+                    double exp_information = ExpectedInformation(less_counts, total_counts, k, size);
+                    if( max_info_split.second < total_information - exp_information )
+                    {
+                        max_info_split.first = cuts[b];
+                        max_info_split.second = total_information - exp_information;
+                    }
                 }
+                return max_info_split;
+            }
 
-                less_data.push_back(new_row);
-                new_row.clear();
+            // Otherwise the node is small, so sort its objects by bin and try
+            // the split after each bin that is followed by another
+            std::vector<std::pair<unsigned char,int>> binned(size);
+            for(unsigned int k = 0; k < size; ++k)
+                binned[k] = std::make_pair(codes[sample.order[begin + k]], data.categories[sample.order[begin + k]]);
+            std::sort(binned.begin(), binned.end());
 
-                // Add greater-indexed data to greater sets
-                for(std::vector<unsigned int>::iterator grit = greater_indices.begin(); grit < greater_indices.end(); ++grit)
+            for(unsigned int k = 0; k < size; ++k)
+            {
+                if( k > 0 && binned[k - 1].first < binned[k].first )
                 {
-                    new_row.push_back(local_data[attr][*grit]);
+                    double exp_information = ExpectedInformation(less_counts, total_counts, k, size);
+                    if( max_info_split.second < total_information - exp_information )
+                    {
+                        max_info_split.first = cuts[binned[k - 1].first];
+                        max_info_split.second = total_information - exp_information;
+                    }
                 }
 
-                greater_data.push_back(new_row);
-                new_row.clear();
-
+                ++less_counts[binned[k].second];
             }
+            return max_info_split;
+        }
 
-            // Calculate less node
-            //std::cout << "Number of lesser objects: " << less_data.size() << std::endl;
-            new_node->less = GenerateNode(less_data, less_classes);
-
-            // Calculate greater node
-            //std::cout << "Number of greater objects: " << greater_data.size() << std::endl;
-            new_node->greater = GenerateNode(greater_data, greater_classes);
-
-            // Assign split point
-            new_node->split_point = max_info_split.second.first;
+        // ExpectedInformation: Information remaining once the size objects of a
+        // node, total_counts of each category, are split after the first k of
+        // them, less_counts of each category
+        double ExpectedInformation(const std::vector<unsigned int>& less_counts, const std::vector<unsigned int>& total_counts,
+                                   unsigned int k, unsigned int size) const
+        {
+            double exp_information = 0.0;
 
-            // Assign attribute
-            new_node->attribute = max_info_split.first;
+            // Calculate the information using the counting data
+            for(unsigned int m = 0; m < less_counts.size(); ++m)
+            {
+                // p( less | class ) = less_counts[m]/double(k)
+                // p( greater | class ) = double(total_counts[m] - less_counts[m])/(size - k)
+                // p( less ) = double(k)/size
+                // p( greater ) = double(size - k)/size
+                if(double(less_counts[m])/double(k) > 0.0)
+                    exp_information -= double(k)/double(size) * double(less_counts[m])/double(k) * log2(double(less_counts[m])/double(k));
+
+                if(double(total_counts[m] - less_counts[m])/double(size - k) > 0.0)
+                    exp_information -= (double(size - k)/double(size))
+                                        *(double(total_counts[m] - less_counts[m])/double(size - k))
+                                        *log2(double(total_counts[m] - less_counts[m])/double(size - k));
+            }
 
-            // Return node
-            return new_node;
+            return exp_information;
         }
-	
-        // Classify: Private lookup function for recursively classifying a data entry
-        // (the length of data is assumed to be equal to the "predictors" variable).
-        int Classify(std::vector<double> data, Node* curr_node)
+
+        // Flatten: Stores the tree under root into nodes in breadth first order
+        void Flatten(Node* root)
         {
-            //std::cout << "classifying" << std::endl;
-            // If less == nullptr, then greater == nullptr by construction
-            if(curr_node->less != nullptr)
-            {
-                // If data < split, then the object is classified in the less branch
-                if(data[curr_node->attribute] < curr_node->split_point)
-                {   /* std::cout << "less" << std::endl;*/ return Classify(data, curr_node->less); }
+            std::queue<Node*> pending;
+            pending.push(root);
+            nodes.clear();
 
-                // Otherwise, the data must be in the greater half
-                else
-                {    /*std::cout << "greater" << std::endl;*/ return Classify(data, curr_node->greater);    }
+            // Each node's children are queued together, so they are given
+            // consecutive places directly after every node queued before them
+            while(!pending.empty())
+            {
+                Node* curr_node = pending.front();
+                pending.pop();
+
+                FlatNode flat;
+                flat.attribute = curr_node->attribute;
+                flat.split_point = 0.0;
+                flat.less = 0;
+                if(curr_node->less != nullptr)
+                {
+                    flat.split_point = curr_node->split_point;
+                    flat.less = nodes.size() + pending.size() + 1;
+                    pending.push(curr_node->less);
+                    pending.push(curr_node->greater);
+                }
+                nodes.push_back(flat);
             }
 
-            // Otherwise, return attribute since the node is terminal
-            return curr_node->attribute;
+            return;
         }
 	
         // Destroy: Recursively destroys nodes for cleaning memory during destruction
@@ -0,0 +1,225 @@
+/*
+ *    Programmer: Milan Zanussi
+ *    Course: Introduction to Artificial Intelligence (CSCI 4350)
+ *    Professor: Dr. Joshua Phillips
+ *
+ *    Project: The ID3 Algorithms for Supervised Learning
+ *    File: task_pool.h
+ *    File Description: Header file containing a pool of threads
+ *    which run tasks that may themselves spawn further tasks, used
+ *    to build the subtrees of a decision tree at the same time.
+ *
+ */
+
+#ifndef TASK_POOL
+#define TASK_POOL
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// task_pool: Runs tasks on a fixed set of threads by work stealing. Each
+// thread keeps its own queue, running the newest of its tasks first and,
+// once it runs out, taking the oldest task of another thread. Tasks are
+// counted in a group counter given when they are spawned, and a thread
+// waiting on a group runs queued tasks until the whole group is done, so
+// tasks may wait on the tasks they spawn without tying up a thread.
+class task_pool
+{
+
+    // ******************** PUBLIC CLASS CONTENTS ******************** \\
+
+    public:
+
+        // task_pool constructor: The thread which creates the pool counts as
+        // one of its threads, and only runs tasks while it waits on a group
+        task_pool(unsigned int threads = 0)
+            : queues(ThreadCount(threads))
+        {
+            queued = 0;
+            stopping = false;
+            for(unsigned int t = 1; t < queues.size(); ++t)
+                workers.emplace_back(&task_pool::Work, this, t);
+            return;
+        }
+
+        // task_pool destructor: Finishes the queued tasks and joins the threads
+        ~task_pool()
+        {
+            {
+                std::lock_guard<std::mutex> guard(sleep_lock);
+                stopping = true;
+            }
+            wake.notify_all();
+
+            for(std::thread& worker : workers)
+                worker.join();
+            return;
+        }
+
+        // Threads: Number of threads running tasks, including the creator
+        unsigned int Threads() const
+        {
+            return queues.size();
+        }
+
+        // Spawn: Queues a task on the calling thread's queue, counting it in
+        // pending until it has run
+        void Spawn(std::function<void()> work, std::atomic<int>& pending)
+        {
+            ++pending;
+            task_queue& queue = queues[Index()];
+            {
+                std::lock_guard<std::mutex> guard(queue.lock);
+                queue.tasks.push_back(task{std::move(work), &pending});
+            }
+
+            // Wake a sleeping thread to take it
+            {
+                std::lock_guard<std::mutex> guard(sleep_lock);
+                ++queued;
+            }
+            wake.notify_one();
+            return;
+        }
+
+        // Wait: Runs queued tasks, from any group, until pending reaches zero,
+        // sleeping whenever there is nothing to take
+        void Wait(std::atomic<int>& pending)
+        {
+            unsigned int index = Index();
+            task next;
+            while(pending > 0)
+            {
+                if(Take(index, next))
+                {
+                    Run(next);
+                    continue;
+                }
+
+                // Sleep until a task is queued or the group finishes
+                std::unique_lock<std::mutex> guard(sleep_lock);
+                wake.wait(guard, [this, &pending]() { return queued > 0 || pending == 0; });
+            }
+            return;
+        }
+
+    // ******************** PRIVATE CLASS CONTENTS ******************** \\
+
+    private:
+
+        // task: A queued piece of work and the group counting it
+        struct task
+        {
+            std::function<void()> work;
+            std::atomic<int>* pending;
+        };
+
+        // task_queue: The tasks spawned by one thread
+        struct task_queue
+        {
+            std::mutex lock;
+            std::deque<task> tasks;
+        };
+
+        std::vector<task_queue> queues;     // One queue per thread, the creator's first
+        std::vector<std::thread> workers;   // Every thread but the creator
+        std::mutex sleep_lock;              // Guards queued and stopping for sleeping threads
+        std::condition_variable wake;       // Signalled when a task is queued, a group finishes or the pool stops
+        std::atomic<int> queued;            // Tasks waiting in any queue
+        bool stopping;                      // Set once the pool is being destroyed
+
+        // ThreadCount: Threads to use when asked for the given number, where
+        // zero asks for one per core
+        static unsigned int ThreadCount(unsigned int threads)
+        {
+            if(threads == 0)
+                threads = std::thread::hardware_concurrency();
+            return (threads > 0) ? threads : 1;
+        }
+
+        // Index: Queue of the calling thread. Threads outside the pool,
+        // including the creator, share the first queue.
+        unsigned int Index() const
+        {
+            const std::pair<const task_pool*, unsigned int>& self = Self();
+            return (self.first == this) ? self.second : 0;
+        }
+
+        // Self: The pool the calling thread works for and its queue there
+        static std::pair<const task_pool*, unsigned int>& Self()
+        {
+            static thread_local std::pair<const task_pool*, unsigned int> self(nullptr, 0);
+            return self;
+        }
+
+        // Take: Removes the newest task of the given queue or, if it is
+        // empty, the oldest task of another queue. Returns false if every
+        // queue is empty.
+        bool Take(unsigned int index, task& next)
+        {
+            for(unsigned int offset = 0; offset < queues.size(); ++offset)
+            {
+                task_queue& queue = queues[(index + offset) % queues.size()];
+                std::lock_guard<std::mutex> guard(queue.lock);
+                if(queue.tasks.empty())
+                    continue;
+
+                if(offset == 0)
+                {
+                    next = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else
+                {
+                    next = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                --queued;
+                return true;
+            }
+            return false;
+        }
+
+        // Run: Runs a task and then counts it off its group, waking any
+        // thread waiting on the group once it is done
+        void Run(task& next)
+        {
+            next.work();
+            if(--*next.pending == 0)
+            {
+                std::lock_guard<std::mutex> guard(sleep_lock);
+                wake.notify_all();
+            }
+            return;
+        }
+
+        // Work: Loop of each pool thread, running tasks until the pool stops
+        void Work(unsigned int index)
+        {
+            Self() = std::make_pair(this, index);
+
+            task next;
+            while(true)
+            {
+                if(Take(index, next))
+                {
+                    Run(next);
+                    continue;
+                }
+
+                // Sleep until a task is queued somewhere
+                std::unique_lock<std::mutex> guard(sleep_lock);
+                wake.wait(guard, [this]() { return stopping || queued > 0; });
+                if(stopping && queued == 0)
+                    return;
+            }
+        }
+
+};
+
+#endif
@@ -1,157 +1,1103 @@
 #include <iostream>
 #include <iomanip>
+#include <cstdio>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <charconv>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 using namespace std;
 
+// Columns factored together in each panel of the blocked elimination
+#define PANEL_WIDTH  64
+
+// Columns of the trailing matrix updated together, so that the panel rows
+// they read stay in cache (PANEL_WIDTH * TILE_COLUMNS floats)
+#define TILE_COLUMNS 256
+
+// Further image vectors of a dense system read and solved together
+#define IMAGE_BLOCK 64
+
+// Floats per SIMD vector on the target (compile with -march=native to
+// use the widest available), and rows and vectors of columns held in
+// registers by the trailing update kernel
+#if defined(__AVX512F__)
+#define VECTOR_WIDTH   16
+#elif defined(__AVX__)
+#define VECTOR_WIDTH   8
+#else
+#define VECTOR_WIDTH   4
+#endif
+#define KERNEL_ROWS    4
+#define KERNEL_VECTORS 2
+#define KERNEL_COLUMNS (KERNEL_VECTORS*VECTOR_WIDTH)
+
+// Bytes per cache line. Rows are padded to a multiple of this so every
+// row starts on a cache line.
+#define CACHE_LINE 64
+
+// Largest number of refinement steps taken by the mixed precision solve
+#define MAX_REFINEMENT_STEPS 30
+
+// Version of the binary system and solution files, and the bytes
+// before their items, keeping double items 8-byte aligned
+#define SYSTEM_FILE_VERSION 1
+#define SYSTEM_FILE_HEADER  24
+
+// Largest condition number accepted with -c: beyond the reciprocal of
+// the single precision epsilon the solutions may have no correct digits
+#define MAX_CONDITION (1/numeric_limits<float>::epsilon())
+
+// Largest systems solved by the batched kernels, whose loops are
+// unrolled for each size up to this
+#define MAX_BATCH_SIZE 16
+
+// Largest sparse matrix factored as a dense one when no band suits it:
+// its factors alone take a gigabyte of floats at this size
+#define MAX_DENSE_ROWS 16384
+
+
+// FLOAT VECTOR:
+//  VECTOR_WIDTH floats operated on by single SIMD instructions
+typedef float FloatVector __attribute__((vector_size(VECTOR_WIDTH*sizeof(float))));
+
+// INT VECTOR:
+//  VECTOR_WIDTH ints, as produced by comparing two
+//  FloatVectors (all bits set where true)
+typedef int IntVector __attribute__((vector_size(VECTOR_WIDTH*sizeof(int))));
+
+
+// ROW MAJOR MATRIX:
+//  A matrix stored contiguously in row-major order.
+//  Each row is padded to stride items, and
+//  matrix[i][j] reads as it would on a float**.
+template <typename Item>
+struct RowMajorMatrix
+{
+    int rows;
+    int columns;
+    int stride;
+    Item* data;
+
+    Item* operator[](int row) { return data + size_t(row)*stride; }
+    const Item* operator[](int row) const { return data + size_t(row)*stride; }
+};
+
+// DENSE MATRIX:
+//  The single precision matrices everything is
+//  factored and solved in.
+typedef RowMajorMatrix<float> DenseMatrix;
+
+// DOUBLE MATRIX:
+//  A double precision matrix, kept to measure the
+//  residuals of single precision solutions.
+typedef RowMajorMatrix<double> DoubleMatrix;
+
+// REFINEMENT REPORT:
+//  The outcome of a mixed precision solve.
+struct RefinementReport
+{
+    int steps;               // Corrections applied after the first solve
+    double backwardError;    // Final normwise backward error
+    double residualNorm;     // Largest entry of the final residual
+    bool converged;          // Whether the target backward error was reached
+};
+
+// LU FACTORIZATION:
+//  A matrix factored once so that any number of image
+//  vectors can be solved against it. The rows of the
+//  matrix were divided by rowScales before factoring,
+//  and the rows of lu were swapped with the rows in
+//  pivots, in order.
+struct LUFactorization
+{
+    DenseMatrix lu;
+    int* pivots;
+    double* rowScales;
+};
+
+// SPARSE MATRIX:
+//  A matrix in compressed sparse row form. The
+//  nonzero items of row i are values[rowStarts[i]]
+//  up to values[rowStarts[i+1]], in the columns given
+//  by columnIndices, which are sorted within a row.
+struct SparseMatrix
+{
+    int rows;
+    int columns;
+    vector<int> rowStarts;
+    vector<int> columnIndices;
+    vector<float> values;
+};
+
+// BAND MATRIX:
+//  A square matrix whose items all lie within lower
+//  diagonals below the main one and upper diagonals
+//  above it. Each row keeps lower + upper + lower + 1
+//  items, leaving room for the fill that row swaps
+//  bring into U, and band[i][j] reads as it would on
+//  a float** for any j within row i's band.
+struct BandMatrix
+{
+    int size;
+    int lower;
+    int upper;
+    int width;
+    float* data;
+
+    float* operator[](int row) { return data + size_t(row)*(width - 1) + lower; }
+    const float* operator[](int row) const { return data + size_t(row)*(width - 1) + lower; }
+};
+
+// SOLVER PATH:
+//  The ways a sparse matrix can be factored.
+enum SolverPath
+{
+    THOMAS_PATH,              // Tridiagonal and diagonally dominant, no pivoting
+    BAND_PATH,                // Band LU with partial pivoting
+    REORDERED_BAND_PATH,      // Band LU after reordering to narrow the band
+    DENSE_PATH                // Blocked dense LU
+};
+
+// STRUCTURED FACTORIZATION:
+//  A sparse matrix factored by whichever path its
+//  structure makes cheapest. The rows were divided by
+//  rowScales, then rows and columns were reordered so
+//  that row k is the original row order[k] when order
+//  is not NULL.
+struct StructuredFactorization
+{
+    SolverPath path;
+    int size;
+    BandMatrix band;          // Factors of the band paths
+    int* pivots;              // Row swapped into each row of band
+    int* order;               // Original index of each reordered row and column
+    double* rowScales;        // Divisor of each original row
+    LUFactorization dense;    // Factors of the dense path
+};
+
+// BATCHED SYSTEMS:
+//  Many independent systems of one small size, stored
+//  interleaved so that the same item of VECTOR_WIDTH
+//  consecutive systems forms one SIMD vector. Item
+//  (i, j) of system s is lane s % VECTOR_WIDTH of
+//  matrices[(s / VECTOR_WIDTH)*size*size + i*size + j],
+//  and item i of its image vector is the same lane of
+//  images[(s / VECTOR_WIDTH)*size + i]. Solving leaves
+//  the preimages in images, and marks the systems
+//  without a unique solution in singular.
+struct BatchedSystems
+{
+    int size;
+    int count;
+    int groups;               // Sets of VECTOR_WIDTH systems
+    FloatVector* matrices;
+    FloatVector* images;
+    bool* singular;
+
+    float& Item(int system, int row, int column)
+    {
+        FloatVector* items = matrices + size_t(system/VECTOR_WIDTH)*size*size + row*size + column;
+        return reinterpret_cast<float*>(items)[system%VECTOR_WIDTH];
+    }
+
+    float& Image(int system, int row)
+    {
+        FloatVector* items = images + size_t(system/VECTOR_WIDTH)*size + row;
+        return reinterpret_cast<float*>(items)[system%VECTOR_WIDTH];
+    }
+};
+
+// SYSTEM FILE:
+//  A linear system read from a binary system file,
+//  which holds "LSYS", then the version, rows, columns,
+//  number of image vectors and bytes per item (4 or 8)
+//  as 32-bit integers, then the matrix in row-major
+//  order followed by the image vectors. The file is
+//  memory mapped where possible, so its items are
+//  copied straight out of the page cache.
+struct SystemFile
+{
+    int rows;
+    int columns;
+    int images;
+    int itemBytes;
+    const char* items;    // First item of the matrix
+    void* mapping;        // Mapped file, or NULL if it was read into buffer
+    size_t bytes;         // Bytes mapped
+    double* buffer;       // Items read without mapping
+};
+
+// BINARY WRITER:
+//  Writes a binary system file, or a solution file
+//  laid out the same way with "LSOL", no columns and
+//  the solutions as its vectors. The number of vectors
+//  is filled in when the file is closed.
+struct BinaryWriter
+{
+    FILE* file;
+    int vectors;
+    int itemBytes;
+};
+
+// TEXT INPUT:
+//  The whole of the standard input, read at once to
+//  be parsed in place.
+struct TextInput
+{
+    vector<char> text;
+    const char* next;
+    const char* end;
+};
+
+// CREATE MATRIX:
+//  Allocates a zeroed rows by columns matrix with
+//  every row aligned to a cache line.
+template <typename Item = float>
+RowMajorMatrix<Item> CreateMatrix(int rows, int columns);
 
 // ROW SWAP:
-//  Swaps two rows on a matrix, assuming
-//  that the rows are represented by a pointer
-//  pointing to an array.
-void SwapRows(float** matrix, int row1, int row2);
+//  Swaps the contents of two rows of a matrix, or only
+//  their columns [firstColumn, lastColumn) when given.
+void SwapRows(DenseMatrix& matrix, int row1, int row2, int firstColumn = 0, int lastColumn = -1);
 
 // PRINT MATRIX:
 //  Iterates through a matrix and prints
 //  each item assuming rows come before
-//  columns.
-void PrintMatrix(float** matrix, int rows, int columns);
+//  columns. Prints zeros below the diagonal
+//  if only the upper triangle is wanted.
+void PrintMatrix(const DenseMatrix& matrix, bool upperTriangle = false);
 
 // DESTROY MATRIX:
-//  Deallocates information stored in a two
-//  dimensional array representing a matrix
-void DestroyMatrix(float**& matrix, int rows, int columns);
+//  Deallocates information stored in a
+//  matrix and leaves it empty.
+template <typename Item>
+void DestroyMatrix(RowMajorMatrix<Item>& matrix);
 
 // SCALE ROWS:
 //  Scales each row such that the maximum element has
 //  an absolute value of 1. Returns false if an entire
-//  row is zero.
-bool ScaleRows(float** matrix, int rows, int columns, float* imageVector);
+//  row is zero. The image vector is skipped if NULL,
+//  and the divisor of each row is kept in rowScales
+//  if given.
+bool ScaleRows(DenseMatrix& matrix, float* imageVector, double* rowScales = NULL);
+
+// FACTOR MATRIX:
+//  Scales and factors the matrix in place, handing it
+//  over to factors (the matrix is left empty). Returns
+//  false if an entire row is zero, leaving factors
+//  empty. The scaled and eliminated matrices are
+//  printed along the way if asked, and the image
+//  vector, unless NULL, is scaled and eliminated
+//  alongside the matrix.
+bool FactorMatrix(DenseMatrix& matrix, LUFactorization& factors, int threads = 1, bool print = false,
+                  float* imageVector = NULL);
+
+// SOLVE FACTORED:
+//  Overwrites the image vector with its preimage under
+//  a factored matrix.
+void SolveFactored(const LUFactorization& factors, float* imageVector);
+
+// SOLVE FACTORED MANY:
+//  Overwrites every column of images, each an image
+//  vector, with its preimage under a factored matrix.
+void SolveFactoredMany(const LUFactorization& factors, DenseMatrix& images);
+
+// DESTROY FACTORIZATION:
+//  Deallocates a factorization and leaves it empty.
+void DestroyFactorization(LUFactorization& factors);
+
+// REFINED SOLVE:
+//  Solves the system in double precision using the
+//  single precision factors of the matrix: the float
+//  solution is corrected with residuals computed in
+//  double against the original matrix until the
+//  normwise backward error reaches targetError or
+//  stops improving, keeping the best solution found.
+RefinementReport RefinedSolve(const DoubleMatrix& matrix, const LUFactorization& factors,
+                              const double* imageVector, double* preimage, double targetError);
+
+// RESIDUAL:
+//  Stores image - matrix * preimage in residual,
+//  accumulating in double, and returns its largest
+//  absolute entry.
+double Residual(const DoubleMatrix& matrix, const double* imageVector, const double* preimage, double* residual);
+
+// SOLVE FACTORED TRANSPOSED:
+//  Overwrites the image vector with its preimage under
+//  the transpose of a factored matrix.
+void SolveFactoredTransposed(const LUFactorization& factors, float* imageVector);
+
+// LOG DETERMINANT:
+//  Returns the natural log of the absolute value of
+//  the determinant of a factored matrix, which cannot
+//  overflow or underflow as the determinant itself can,
+//  and sets sign to the sign of the determinant (0 if
+//  the matrix is singular).
+double LogDeterminant(const LUFactorization& factors, int& sign);
+
+// ONE NORM:
+//  Returns the largest absolute column sum of a matrix.
+double OneNorm(const DenseMatrix& matrix);
+
+// CONDITION ESTIMATE:
+//  Estimates the 1-norm condition number of a factored
+//  matrix, ||A|| ||A^-1||, given its 1-norm, from a few
+//  solves with its factors and their transpose in O(n^2)
+//  work. The estimate of ||A^-1|| is a lower bound,
+//  rarely more than a factor of 3 below it.
+double ConditionEstimate(const LUFactorization& factors, double matrixNorm);
+
+// INVERT FACTORED:
+//  Overwrites a factorization with the inverse of the
+//  matrix it factors, leaving the inverse in lu, after
+//  which it can no longer be solved against. Returns
+//  false, leaving the factors unchanged, if the matrix
+//  is singular.
+bool InvertFactored(LUFactorization& factors);
+
+// INVERT UPPER:
+//  Replaces the upper triangle U of a factored matrix
+//  with U^-1, a block of rows at a time from the bottom,
+//  leaving the multipliers below the diagonal.
+void InvertUpper(DenseMatrix& matrix);
+
+// MULTIPLY INVERSE LOWER:
+//  Replaces a matrix holding U^-1 above and L below its
+//  diagonal with U^-1 L^-1, a block of columns at a time
+//  from the right.
+void MultiplyInverseLower(DenseMatrix& matrix);
 
 // GUASSIAN ELIMINATION:
 //  Performs Gaussian elimination on a matrix using
-//  scaled partial pivoting.
-void GaussianElimination(float** matrix, int matrixSize, float* imageVector);
+//  scaled partial pivoting, leaving the upper-triangular
+//  matrix in the matrix and eliminating the image vector
+//  alongside it. Factors on the given number of threads.
+void GaussianElimination(DenseMatrix& matrix, float* imageVector, int threads = 1);
+
+// BLOCKED LU:
+//  Factors the matrix in place into a unit lower-
+//  triangular L (below the diagonal) and an upper-
+//  triangular U, recording in pivots the row swapped
+//  into each row. Works a panel of columns at a time,
+//  on several threads if asked. The image vector is
+//  eliminated alongside the matrix unless it is NULL.
+void BlockedLU(DenseMatrix& matrix, int* pivots, int threads = 1, float* imageVector = NULL);
+
+// PARALLEL LU:
+//  Factors the matrix exactly as BlockedLU does, but
+//  runs the panel factorizations and the updates of
+//  each panel-wide block of columns as tasks on a pool
+//  of threads, starting each task once the tasks it
+//  depends on are done.
+void ParallelLU(DenseMatrix& matrix, int* pivots, int threads, float* imageVector);
+
+// FACTOR PANEL:
+//  Eliminates the columns [first, first+width) of the
+//  rows at and below first, pivoting as it goes. Rows
+//  are only swapped within the panel's columns. The
+//  image vector is eliminated alongside, unless NULL.
+void FactorPanel(DenseMatrix& matrix, int first, int width, int* pivots, float* imageVector = NULL);
+
+// UPDATE TRAILING:
+//  Applies a factored panel to the columns
+//  [columnBegin, columnEnd) right of it: swaps their
+//  rows as the panel did, solves for their block of U
+//  and subtracts the panel's rank-width product from
+//  the rows below.
+void UpdateTrailing(DenseMatrix& matrix, const int* pivots, int first, int width,
+                    int columnBegin, int columnEnd);
+
+// APPLY LEFT SWAPS:
+//  Swaps the multipliers of every panel as the panels
+//  after it swapped their rows, once all are factored.
+void ApplyLeftSwaps(DenseMatrix& matrix, const int* pivots);
+
+// MULTIPLY SUBTRACT:
+//  Subtracts the product of the given row and column
+//  ranges of the panel from the block of the trailing
+//  matrix they meet in, a tile at a time.
+void MultiplySubtract(DenseMatrix& matrix, int first, int width,
+                      int rowBegin, int rowEnd, int columnBegin, int columnEnd);
+
+// SUBTRACT MULTIPLE:
+//  Subtracts multiplier times source from target over
+//  the items [begin, end), a SIMD vector at a time.
+void SubtractMultiple(float* target, const float* source, float multiplier, int begin, int end);
 
 // PARTIAL PIVOT
 //  Swaps rows in the matrix to ensure that there is
 //  no accidental zero or close-to-zero division during
-//  Gaussian elimination.
-void PartialPivot(float** matrix, int matrixSize, int elimStep, float* imageVector);
+//  Gaussian elimination. Returns the row swapped in.
+//  Only the columns [firstColumn, lastColumn) are
+//  swapped when given.
+int PartialPivot(DenseMatrix& matrix, int elimStep, float* imageVector,
+                 int firstColumn = 0, int lastColumn = -1);
+
+// FORWARD SUBSTITUTION:
+//  Applies the row swaps and the unit lower-triangular
+//  factor to the image vector, eliminating it as
+//  Gaussian elimination would have.
+void ForwardSubstitution(const DenseMatrix& matrix, const int* pivots, float* imageVector);
+
+// FORWARD SUBSTITUTION MANY:
+//  Forward substitution for every column of images
+//  at once.
+void ForwardSubstitution(const DenseMatrix& matrix, const int* pivots, DenseMatrix& images);
 
 // BACK SUBSTITUTION:
 //  Propagates back up through the upper-triangular matrix
 //  to set the imageVector to the pre-image of the system
-void BackSubstitution(float** matrix, int matrixSize, float* imageVector);
+void BackSubstitution(const DenseMatrix& matrix, float* imageVector);
+
+// BACK SUBSTITUTION MANY:
+//  Back substitution for every column of images at
+//  once, the rows of images being updated as whole
+//  vectors.
+void BackSubstitution(const DenseMatrix& matrix, DenseMatrix& images);
 
 // ABSOLUTE FLOAT:
 float absf(float number);
 
-int main()
+// PRINT REFINED SOLUTION:
+//  Prints a refined preimage in full precision
+//  along with how the refinement went.
+void PrintRefinedSolution(const RefinementReport& report, const double* preimage, int matrixSize);
+
+// SOLVE BATCH INPUT:
+//  Reads many systems of one size and solves them as
+//  a batch, printing or writing their preimages.
+int SolveBatchInput(int threads, const char* solutionPath);
+
+// CREATE BATCH:
+//  Allocates count systems of the given size, each an
+//  identity matrix with a zero image vector until set.
+BatchedSystems CreateBatch(int size, int count);
+
+// DESTROY BATCH:
+//  Deallocates a batch and leaves it empty.
+void DestroyBatch(BatchedSystems& batch);
+
+// SOLVE BATCH:
+//  Solves every system of a batch by Gaussian
+//  elimination with scaled partial pivoting, VECTOR_WIDTH
+//  systems at a time, sharing the groups between the
+//  given number of threads. Returns the number of
+//  systems without a unique solution, whose preimages
+//  are left as NaN. Sizes above MAX_BATCH_SIZE are not
+//  solved and return -1.
+int SolveBatch(BatchedSystems& batch, int threads = 1);
+
+// SOLVE BATCH GROUPS:
+//  Solves the groups [firstGroup, lastGroup) of a batch
+//  of systems of SIZE.
+template <int SIZE>
+void SolveBatchGroups(BatchedSystems& batch, int firstGroup, int lastGroup);
+
+// SOLVE GROUP:
+//  Solves VECTOR_WIDTH systems of SIZE at once, one per
+//  lane, each pivoting on its own rows. Returns all bits
+//  set in the lanes without a unique solution.
+template <int SIZE>
+IntVector SolveGroup(FloatVector* matrix, FloatVector* image);
+
+// OPEN SYSTEM FILE:
+//  Maps, or failing that reads, a binary system file.
+//  Returns false unless the file holds exactly the
+//  items its header promises.
+bool OpenSystemFile(const char* path, SystemFile& system);
+
+// LOAD ITEMS:
+//  Copies count items of a system file, starting at
+//  item first, converting them to Item.
+template <typename Item>
+void LoadItems(const SystemFile& system, size_t first, int count, Item* items);
+
+// CLOSE SYSTEM FILE:
+//  Unmaps or frees a system file.
+void CloseSystemFile(SystemFile& system);
+
+// OPEN BINARY WRITER:
+//  Creates a binary file with the given magic and
+//  sizes, holding items of itemBytes bytes. Returns
+//  false, with no file left open, if the file or its
+//  header could not be written.
+bool OpenBinaryWriter(BinaryWriter& writer, const char* path, const char* magic,
+                      int rows, int columns, int itemBytes);
+
+// WRITE ITEMS:
+//  Appends count items to a binary file, converting
+//  them to the file's precision.
+template <typename Item>
+bool WriteItems(BinaryWriter& writer, const Item* items, int count);
+
+// CLOSE BINARY WRITER:
+//  Fills in the number of vectors written and closes
+//  the file. Returns false if anything failed to write.
+bool CloseBinaryWriter(BinaryWriter& writer);
+
+// READ TEXT INPUT:
+//  Reads the whole of the standard input.
+void ReadTextInput(TextInput& input);
+
+// READ NUMBER:
+//  Parses the next number of the input. Returns false
+//  once the input is used up or is not a number.
+template <typename Number>
+bool ReadNumber(TextInput& input, Number& number);
+
+// SOLVE SPARSE INPUT:
+//  Reads a system given as its nonzero items and
+//  solves it, along with any further image vectors,
+//  by the path its structure suits best. Without
+//  prompts, as in quiet mode, the input is read at
+//  once and only the solutions are printed.
+int SolveSparseInput(int threads, bool quiet);
+
+// CREATE SPARSE MATRIX:
+//  Builds a sparse matrix from (row, column, value)
+//  items in any order, summing repeated items and
+//  dropping zeros.
+SparseMatrix CreateSparseMatrix(int rows, int columns, const vector<int>& rowIndices,
+                                const vector<int>& columnIndices, const vector<float>& values);
+
+// SCALE SPARSE ROWS:
+//  Scales each row of a sparse matrix as ScaleRows
+//  does, keeping the divisors in rowScales. Returns
+//  false if an entire row is zero.
+bool ScaleRows(SparseMatrix& matrix, double* rowScales);
+
+// BANDWIDTHS:
+//  Finds how many diagonals below and above the main
+//  one hold nonzero items.
+void Bandwidths(const SparseMatrix& matrix, int& lower, int& upper);
+
+// DIAGONALLY DOMINANT:
+//  Whether every diagonal item is at least as large as
+//  the rest of its row together, in which case the
+//  matrix is factored stably without pivoting.
+bool DiagonallyDominant(const SparseMatrix& matrix);
+
+// REVERSE CUTHILL MCKEE:
+//  Orders the rows and columns of a matrix so that its
+//  nonzero items cluster near the diagonal: a breadth
+//  first search of the graph of A + A^T from a node far
+//  from the rest, visiting neighbors by increasing
+//  degree, reversed. order[k] is the original index
+//  placed k-th.
+void ReverseCuthillMcKee(const SparseMatrix& matrix, int* order);
+
+// PERMUTE SYMMETRIC:
+//  Reorders both the rows and the columns of a matrix,
+//  row and column k of the result being row and column
+//  order[k] of the matrix.
+SparseMatrix PermuteSymmetric(const SparseMatrix& matrix, const int* order);
+
+// CREATE BAND MATRIX:
+//  Copies a sparse matrix into band storage with the
+//  given bandwidths, which must hold all its items.
+BandMatrix CreateBandMatrix(const SparseMatrix& matrix, int lower, int upper);
+
+// DESTROY BAND MATRIX:
+//  Deallocates a band matrix and leaves it empty.
+void DestroyBandMatrix(BandMatrix& band);
+
+// THOMAS FACTOR:
+//  Factors a tridiagonal band matrix in place without
+//  pivoting. Returns false on a zero pivot.
+bool ThomasFactor(BandMatrix& band);
+
+// THOMAS SOLVE:
+//  Overwrites the image vector with its preimage under
+//  a tridiagonal matrix factored by ThomasFactor.
+void ThomasSolve(const BandMatrix& band, float* imageVector);
+
+// BAND LU:
+//  Factors a band matrix in place with partial
+//  pivoting, recording the row swapped into each row
+//  in pivots. Only rows within the lower bandwidth are
+//  candidates, and U gains at most lower diagonals.
+//  Returns false if a column has no nonzero pivot.
+bool BandLU(BandMatrix& band, int* pivots);
+
+// BAND SOLVE:
+//  Overwrites the image vector with its preimage under
+//  a band matrix factored by BandLU.
+void BandSolve(const BandMatrix& band, const int* pivots, float* imageVector);
+
+// FACTOR STRUCTURED:
+//  Scales and factors a sparse matrix by the cheapest
+//  path: the Thomas algorithm for diagonally dominant
+//  tridiagonal matrices, otherwise band LU in the given
+//  order or after reordering, or dense LU when neither
+//  band is narrow enough to save work. Returns false
+//  if the matrix is singular, or needs dense LU but has
+//  more than MAX_DENSE_ROWS rows, leaving factors empty.
+bool FactorStructured(const SparseMatrix& matrix, StructuredFactorization& factors, int threads = 1);
+
+// SOLVE STRUCTURED:
+//  Overwrites the image vector with its preimage under
+//  a matrix factored by FactorStructured.
+void SolveStructured(const StructuredFactorization& factors, float* imageVector);
+
+// DESTROY STRUCTURED:
+//  Deallocates a structured factorization and leaves
+//  it empty.
+void DestroyStructured(StructuredFactorization& factors);
+
+int main(int argc, char** argv)
 {
     // Matrix to store user data
-    float** matrix;
+    DenseMatrix matrix;
     float* imageVector;
 
+    // Double precision copies kept for refinement
+    DoubleMatrix original;
+    double* originalImage = NULL;
+    double* preimage = NULL;
+
     // Variables to store any user input
     int ROWS, COLUMNS;
 
-    // Prompt user for matrix size
-    cout << "How many rows and columns: ";
-    cin >> ROWS >> COLUMNS;
+    // Threads to factor on (0 uses every core), -r to
+    // refine the solutions to double precision, -s to
+    // give the matrix as its nonzero items (solved densely
+    // only up to MAX_DENSE_ROWS rows when no narrow band
+    // is found), -m to solve many small systems at once,
+    // and -q to read the system without prompts and print
+    // only the solutions. -c reports the determinant and condition
+    // of the matrix and refuses to solve systems too
+    // ill-conditioned to trust, and -i prints the inverse
+    // of the matrix. -b reads the system from a binary system
+    // file, -o writes the solutions to a binary solution
+    // file and -w saves the system read to a binary
+    // system file instead of solving it.
+    int threads = 1;
+    bool refine = false, sparse = false, batch = false, quiet = false;
+    bool condition = false, inverse = false;
+    const char* systemPath = NULL;
+    const char* solutionPath = NULL;
+    const char* savePath = NULL;
+    for(int a = 1; a < argc; ++a)
+    {
+        if(strcmp(argv[a], "-r") == 0)
+            refine = true;
+        else if(strcmp(argv[a], "-s") == 0)
+            sparse = true;
+        else if(strcmp(argv[a], "-m") == 0)
+            batch = true;
+        else if(strcmp(argv[a], "-q") == 0)
+            quiet = true;
+        else if(strcmp(argv[a], "-c") == 0)
+            condition = true;
+        else if(strcmp(argv[a], "-i") == 0)
+            inverse = true;
+        else if(strcmp(argv[a], "-b") == 0 && a + 1 < argc)
+            systemPath = argv[++a];
+        else if(strcmp(argv[a], "-o") == 0 && a + 1 < argc)
+            solutionPath = argv[++a];
+        else if(strcmp(argv[a], "-w") == 0 && a + 1 < argc)
+            savePath = argv[++a];
+        else
+            threads = atoi(argv[a]);
+    }
+    if(threads < 1)
+        threads = max(1u, thread::hardware_concurrency());
+
+    if(sparse)
+    {
+        if(refine || systemPath != NULL || solutionPath != NULL || savePath != NULL)
+        {
+            cerr << "ERROR: Refinement and binary files need the matrix given in full." << endl;
+            return -1;
+        }
+        return SolveSparseInput(threads, quiet);
+    }
+
+    if(batch)
+    {
+        if(refine || systemPath != NULL || savePath != NULL)
+        {
+            cerr << "ERROR: Batches are only read as text and solved in single precision." << endl;
+            return -1;
+        }
+        return SolveBatchInput(threads, solutionPath);
+    }
+
+    // Systems given or kept in files are never typed in
+    if(systemPath != NULL || solutionPath != NULL || savePath != NULL)
+        quiet = true;
+
+    // Without prompts the whole input is read at once and
+    // parsed in place, rather than a number at a time
+    SystemFile system;
+    TextInput text;
+    if(systemPath != NULL)
+    {
+        if(!OpenSystemFile(systemPath, system))
+        {
+            cerr << "ERROR: Unable to read a system from " << systemPath << endl;
+            return -1;
+        }
+        ROWS = system.rows;
+        COLUMNS = system.columns;
+    }
+    else
+    {
+        // Prompt user for matrix size
+        if(quiet)
+            ReadTextInput(text);
+        else
+            cout << "How many rows and columns: ";
+
+        ROWS = COLUMNS = 0;
+        if(quiet)
+            ReadNumber(text, ROWS) && ReadNumber(text, COLUMNS);
+        else
+            cin >> ROWS >> COLUMNS;
+    }
 
     if( ROWS != COLUMNS )
     {
         cerr << "ERROR: Matrix not invertible. This system only solves square matrices." << endl;
+        if(systemPath != NULL)
+            CloseSystemFile(system);
         return -1;
     }
 
-    // Generate ROW many columns
-    matrix = new float*[ROWS];
+    // Reads the next number typed or given as text
+    auto read = [&](auto& number) -> bool
+    {
+        if(quiet)
+            return ReadNumber(text, number);
+        return bool(cin >> number);
+    };
+
+    // Generate the matrix and image vector
+    matrix = CreateMatrix(ROWS, COLUMNS);
     imageVector = new float[ROWS];
 
-    // Generates COLUMN many items for each row
-    for(int i = 0; i < ROWS; ++i){
-        matrix[i] = new float[COLUMNS];
+    if(refine)
+    {
+        original = CreateMatrix<double>(ROWS, COLUMNS);
+        originalImage = new double[ROWS];
+        preimage = new double[ROWS];
     }
 
+    // Frees everything above on the way out, including the
+    // matrix unless it was handed over to its factors
+    auto release = [&]()
+    {
+        DestroyMatrix(matrix);
+        delete[] imageVector;
+
+        if(refine)
+        {
+            DestroyMatrix(original);
+            delete[] originalImage;
+            delete[] preimage;
+        }
+        if(systemPath != NULL)
+            CloseSystemFile(system);
+    };
+
     // Prompt user for matrix entries
-    cout << "Input the matrix: " << endl;
+    if(!quiet)
+        cout << "Input the matrix: " << endl;
 
-    // For each item in the matrix
+    // For each row in the matrix
     for(int i = 0; i < ROWS; ++i){
-        for(int j = 0; j < COLUMNS; ++j)
-            cin >> matrix[i][j];
+        // Rows in a system file are copied out whole
+        if(systemPath != NULL)
+        {
+            if(refine)
+                LoadItems(system, size_t(i)*COLUMNS, COLUMNS, original[i]);
+            else
+                LoadItems(system, size_t(i)*COLUMNS, COLUMNS, matrix[i]);
+        }
+        else
+        {
+            for(int j = 0; j < COLUMNS; ++j)
+            {
+                // Refinement keeps the entries as given
+                if(refine)
+                    read(original[i][j]);
+                else
+                    read(matrix[i][j]);
+            }
+        }
+
+        if(refine)
+            copy(original[i], original[i] + COLUMNS, matrix[i]);
+    }
+
+    // Reads the image vector of the given index, returning
+    // false once every image vector given has been read
+    auto readImage = [&](int index) -> bool
+    {
+        if(systemPath != NULL)
+        {
+            if(index >= system.images)
+                return false;
+
+            size_t first = size_t(ROWS)*COLUMNS + size_t(index)*ROWS;
+            if(refine)
+                LoadItems(system, first, ROWS, originalImage);
+            else
+                LoadItems(system, first, ROWS, imageVector);
+        }
+        else
+        {
+            for(int i = 0; i < ROWS; ++i)
+            {
+                if(!(refine ? read(originalImage[i]) : read(imageVector[i])))
+                    return false;
+            }
+        }
+
+        if(refine)
+            copy(originalImage, originalImage + ROWS, imageVector);
+        return true;
+    };
+
+    if(!quiet)
+        cout << "Input the image vector:" << endl;
+
+    if(!readImage(0) && quiet)
+    {
+        cerr << "ERROR: No image vector was given." << endl;
+        release();
+        return -1;
     }
 
-    cout << "Input the image vector:" << endl;
+    // Save the system in binary, with every image vector given,
+    // in the precision it was read in
+    if(savePath != NULL)
+    {
+        BinaryWriter writer;
+        bool saved = OpenBinaryWriter(writer, savePath, "LSYS", ROWS, COLUMNS, refine ? sizeof(double) : sizeof(float));
+        for(int i = 0; saved && i < ROWS; ++i)
+            saved = refine ? WriteItems(writer, original[i], COLUMNS) : WriteItems(writer, matrix[i], COLUMNS);
+        for(int k = 1; saved; ++k)
+        {
+            saved = refine ? WriteItems(writer, originalImage, ROWS) : WriteItems(writer, imageVector, ROWS);
+            ++writer.vectors;
+            if(!readImage(k))
+                break;
+        }
+        saved = (writer.file != NULL) && CloseBinaryWriter(writer) && saved;
+
+        if(!saved)
+            cerr << "ERROR: Unable to write the system to " << savePath << endl;
+        release();
+        return saved ? 0 : -1;
+    }
 
-    for(int i = 0; i < ROWS; ++i)
+    // Solutions are written to the solution file if given,
+    // refined ones in double precision
+    BinaryWriter solutions;
+    if(solutionPath != NULL &&
+       !OpenBinaryWriter(solutions, solutionPath, "LSOL", ROWS, 0, refine ? sizeof(double) : sizeof(float)))
     {
-        cin >> imageVector[i];
+        cerr << "ERROR: Unable to write the solutions to " << solutionPath << endl;
+        release();
+        return -1;
     }
 
-    // Scale matrix
-    if(!ScaleRows(matrix, ROWS, COLUMNS, imageVector))
+    // The condition number is measured against the matrix as given
+    double matrixNorm = condition ? OneNorm(matrix) : 0;
+
+    // The matrix is factored once and kept, so any further
+    // image vectors given are solved without eliminating again.
+    // The first image vector is eliminated alongside it.
+    LUFactorization factors;
+    if(!FactorMatrix(matrix, factors, threads, !quiet, imageVector))
     {
         cerr << "ERROR: Matrix not invertible. One row is entirely zero." << endl;
+        if(solutionPath != NULL)
+            CloseBinaryWriter(solutions);
+        release();
         return -1;
     }
 
-    cout << endl << endl << "SCALED MATRIX:" << endl;
-    PrintMatrix(matrix,ROWS,COLUMNS);
-
-    cout << endl << endl << "ELIMINATED MATRIX:" << endl;
-    GaussianElimination(matrix,ROWS, imageVector);
-    PrintMatrix(matrix, ROWS,COLUMNS);
+    if(!quiet)
+    {
+        cout << endl << endl << "ELIMINATED IMAGE VECTOR:" << endl;
 
-    cout << endl << endl << "ELIMINATED IMAGE VECTOR:" << endl;
+        for(int i = 0; i < ROWS; ++i)
+            cout << imageVector[i] << '\n';
+    }
 
+    // The matrix is invertible, and the system has a unique
+    // solution, unless U has a zero on its diagonal
+    bool invertible = true;
     for(int i = 0; i < ROWS; ++i)
-        cout << imageVector[i] << endl;
+        if(factors.lu[i][i] == 0)
+            invertible = false;
 
-    // Take determinant via product of diagonal of matrix
-    float determinant = 1;
-    for(int i = 0; i < ROWS; ++i)
-        determinant *= matrix[i][i];
+    // Report the determinant and condition of the matrix, and
+    // refuse to solve systems too ill-conditioned to trust
+    bool trusted = true;
+    if(condition)
+    {
+        int sign;
+        double logDeterminant = LogDeterminant(factors, sign);
+        double estimate = invertible ? ConditionEstimate(factors, matrixNorm) : HUGE_VAL;
 
-    // If matrix is invertible, it has a unique solution
-    if(determinant != 0)
+        cout << endl << endl << "LOG ABSOLUTE DETERMINANT: " << logDeterminant << endl;
+        cout << "DETERMINANT SIGN: " << sign << endl;
+        cout << "CONDITION ESTIMATE: " << estimate << endl;
+
+        trusted = estimate <= MAX_CONDITION;
+        if(invertible && !trusted)
+            cout << endl << endl << "The matrix is too ill-conditioned to solve." << endl;
+    }
+
+    // Writes a solution to the solution file, or prints it
+    bool written = true;
+    auto writeSolution = [&]()
     {
-        cout << endl << endl << "SOLUTION VECTOR:" << endl;
-        BackSubstitution(matrix,ROWS,imageVector);
+        RefinementReport report = RefinementReport();
+        if(refine)
+            report = RefinedSolve(original, factors, originalImage, preimage, 0);
+
+        if(solutionPath != NULL)
+        {
+            written = written && (refine ? WriteItems(solutions, preimage, ROWS) : WriteItems(solutions, imageVector, ROWS));
+            ++solutions.vectors;
+            return;
+        }
 
+        cout << endl << endl << "SOLUTION VECTOR:" << endl;
         for(int i = 0; i < ROWS; ++i)
-            cout << imageVector[i] << endl;
+            cout << imageVector[i] << '\n';
+        cout << flush;
+
+        if(refine)
+            PrintRefinedSolution(report, preimage, ROWS);
+    };
+
+    // If matrix is invertible, it has a unique solution
+    if(invertible && trusted)
+    {
+        BackSubstitution(factors.lu, imageVector);
+        writeSolution();
+
+        // Solve every further image vector given with the same factors.
+        // Refinement corrects one solution at a time, but otherwise a
+        // block of image vectors is solved at once as the columns of
+        // one matrix.
+        if(refine)
+        {
+            for(int k = 1; readImage(k); ++k)
+            {
+                SolveFactored(factors, imageVector);
+                writeSolution();
+            }
+        }
+        else
+        {
+            DenseMatrix images = CreateMatrix(ROWS, IMAGE_BLOCK);
+            bool more = true;
+            for(int k = 1; more; )
+            {
+                // Gather the next block of image vectors as columns
+                int count = 0;
+                for(; count < IMAGE_BLOCK && (more = readImage(k)); ++count, ++k)
+                    for(int i = 0; i < ROWS; ++i)
+                        images[i][count] = imageVector[i];
+                if(count == 0)
+                    break;
+
+                images.columns = count;
+                SolveFactoredMany(factors, images);
+                images.columns = IMAGE_BLOCK;
+
+                for(int c = 0; c < count; ++c)
+                {
+                    for(int i = 0; i < ROWS; ++i)
+                        imageVector[i] = images[i][c];
+                    writeSolution();
+                }
+            }
+            DestroyMatrix(images);
+        }
+
+        // The factors are only inverted once every solve is done
+        if(inverse)
+        {
+            InvertFactored(factors);
+            cout << endl << endl << "INVERSE MATRIX:" << endl;
+            PrintMatrix(factors.lu);
+        }
     }
 
-    else
+    else if(!invertible)
     {
         cout << endl << endl << "The matrix does not have a unique solution." << endl;
     }
 
-    DestroyMatrix(matrix, ROWS, COLUMNS);
+    if(solutionPath != NULL && !(CloseBinaryWriter(solutions) && written))
+    {
+        cerr << "ERROR: Unable to write the solutions to " << solutionPath << endl;
+        written = false;
+    }
+
+    DestroyFactorization(factors);
+    release();
 
-    return 0;
+    return written ? 0 : -1;
+}
+
+// CREATE MATRIX:
+//  Allocates a zeroed rows by columns matrix with
+//  every row aligned to a cache line.
+template <typename Item>
+RowMajorMatrix<Item> CreateMatrix(int rows, int columns)
+{
+    RowMajorMatrix<Item> matrix;
+    matrix.rows = rows;
+    matrix.columns = columns;
+
+    // Pad each row to a whole number of cache lines
+    int lineItems = CACHE_LINE/sizeof(Item);
+    matrix.stride = ((columns + lineItems - 1)/lineItems)*lineItems;
+    if(matrix.stride == 0)
+        matrix.stride = lineItems;
+
+    size_t bytes = size_t(rows)*matrix.stride*sizeof(Item);
+    if(bytes == 0)
+        bytes = CACHE_LINE;
+    matrix.data = static_cast<Item*>(aligned_alloc(CACHE_LINE, bytes));
+    memset(matrix.data, 0, bytes);
+
+    return matrix;
 }
 
 // ROW SWAP:
-//  Swaps two rows on a matrix, assuming
-//  that the rows are represented by a pointer
-//  pointing to an array.
-void SwapRows(float** matrix, int row1, int row2)
+//  Swaps the contents of two rows of a matrix, or only
+//  their columns [firstColumn, lastColumn) when given.
+void SwapRows(DenseMatrix& matrix, int row1, int row2, int firstColumn, int lastColumn)
 {
-    // Create temp for swapping
-    float* tempPtr;
+    if(lastColumn < 0)
+        lastColumn = matrix.columns;
 
-    // Use tempPtr to swap pointer values in matrix
     // Don't swap if rows are the same
     if(row1 != row2)
-    {
-        tempPtr = matrix[row1];
-        matrix[row1] = matrix[row2];
-        matrix[row2] = tempPtr;
-    }
+        swap_ranges(matrix[row1] + firstColumn, matrix[row1] + lastColumn, matrix[row2] + firstColumn);
 
     return;
 }
@@ -159,21 +1105,24 @@ void SwapRows(float** matrix, int row1, int row2)
 // PRINT MATRIX:
 //  Iterates through a matrix and prints
 //  each item assuming rows come before
-//  columns.
-void PrintMatrix(float** matrix, int rows, int columns)
+//  columns. Prints zeros below the diagonal
+//  if only the upper triangle is wanted.
+void PrintMatrix(const DenseMatrix& matrix, bool upperTriangle)
 {
-    for(int i = 0; i < rows; ++i){
-        for(int j = 0; j < columns; ++j){
+    for(int i = 0; i < matrix.rows; ++i){
+        for(int j = 0; j < matrix.columns; ++j){
+            float item = (upperTriangle && j < i) ? 0.0f : matrix[i][j];
+
             // If this is not the last item in the row
-            if(j < columns - 1){
+            if(j < matrix.columns - 1){
                 // Make space for the next item
-                cout << left << setw(13) << matrix[i][j] << " ";
+                cout << left << setw(13) << item << " ";
             }
 
             // Last item in row
             else {
                 // Move to next row
-                cout << left << setw(13) << matrix[i][j] << endl;
+                cout << left << setw(13) << item << endl;
             }
         }
     }
@@ -182,40 +1131,40 @@ void PrintMatrix(float** matrix, int rows, int columns)
 }
 
 // DESTROY MATRIX:
-//  Deallocates information stored in a two
-//  dimensional array representing a matrix
-void DestroyMatrix(float**& matrix, int rows, int columns)
+//  Deallocates information stored in a
+//  matrix and leaves it empty.
+template <typename Item>
+void DestroyMatrix(RowMajorMatrix<Item>& matrix)
 {
-    // Deallocate all information pointed at by
-    // each pointer
-    for(int i = 0; i < rows; ++i){
-        delete[] matrix[i];
-    }
-
-    // Delete the pointer array
-    delete[] matrix;
-    matrix = NULL;
+    free(matrix.data);
+    matrix.data = NULL;
+    matrix.rows = matrix.columns = matrix.stride = 0;
 
     return;
 }
 
 // SCALE ROWS:
 //  Scales each row such that the maximum element has
-//  an absolute value of 1. Returns false if
-bool ScaleRows(float** matrix, int rows, int cols, float* imageVector)
+//  an absolute value of 1. Returns false if an entire
+//  row is zero. The image vector is skipped if NULL,
+//  and the divisor of each row is kept in rowScales
+//  if given.
+bool ScaleRows(DenseMatrix& matrix, float* imageVector, double* rowScales)
 {
     double rowMaxAbs = 0;
 
-    for(int i = 0; i < rows; ++i)
+    for(int i = 0; i < matrix.rows; ++i)
     {
+        float* row = matrix[i];
+
         // Assume first item is zero
-        rowMaxAbs = double(matrix[i][0]);
+        rowMaxAbs = double(row[0]);
 
         // Find maximum absolute value
-        for(int j = 0; j < cols; ++j)
+        for(int j = 0; j < matrix.columns; ++j)
         {
-            if(double(absf(matrix[i][j])) > rowMaxAbs)
-                rowMaxAbs = double(absf(matrix[i][j]));
+            if(double(absf(row[j])) > rowMaxAbs)
+                rowMaxAbs = double(absf(row[j]));
         }
 
         // If an entire row is zero
@@ -223,12 +1172,15 @@ bool ScaleRows(float** matrix, int rows, int cols, float* imageVector)
             return false;
 
         // Scale the row
-        for(int j = 0; j < cols; ++j)
+        for(int j = 0; j < matrix.columns; ++j)
         {
-            matrix[i][j] = double(matrix[i][j])/rowMaxAbs;
+            row[j] = double(row[j])/rowMaxAbs;
         }
 
-        imageVector[i] = double(imageVector[i])/rowMaxAbs;
+        if(imageVector != NULL)
+            imageVector[i] = double(imageVector[i])/rowMaxAbs;
+        if(rowScales != NULL)
+            rowScales[i] = rowMaxAbs;
     }
 
 
@@ -240,86 +1192,2272 @@ float absf(float number)
     return (number < 0) ? (-1 * number) : (number);
 }
 
+// PRINT REFINED SOLUTION:
+//  Prints a refined preimage in full precision
+//  along with how the refinement went.
+void PrintRefinedSolution(const RefinementReport& report, const double* preimage, int matrixSize)
+{
+    cout << endl << endl << "REFINED SOLUTION VECTOR:" << endl;
+
+    streamsize precision = cout.precision(17);
+    for(int i = 0; i < matrixSize; ++i)
+        cout << preimage[i] << endl;
+    cout.precision(precision);
+
+    cout << "REFINEMENT STEPS: " << report.steps << endl;
+    cout << "RESIDUAL: " << report.residualNorm << endl;
+    cout << "BACKWARD ERROR: " << report.backwardError
+         << (report.converged ? "" : " (did not reach the target)") << endl;
+}
+
 // GAUSSIAN ELIMINATION:
 //  Performs Gaussian elimination on a matrix using
 //  scaled partial pivoting. Only reduces square matrices.
-void GaussianElimination(float** matrix, int matrixSize, float* imageVector)
+//  The matrix is factored as LU a panel at a time, with
+//  the image vector eliminated as each multiplier is
+//  found, then the multipliers below the diagonal are
+//  cleared, leaving what row-by-row elimination would
+//  have left.
+void GaussianElimination(DenseMatrix& matrix, float* imageVector, int threads)
+{
+    int* pivots = new int[matrix.rows];
+
+    BlockedLU(matrix, pivots, threads, imageVector);
+
+    // Clear the multipliers left below the diagonal
+    for(int i = 1; i < matrix.rows; ++i)
+        fill(matrix[i], matrix[i] + i, 0.0f);
+
+    delete[] pivots;
+}
+
+// FACTOR MATRIX:
+//  Scales and factors the matrix in place, handing it
+//  over to factors (the matrix is left empty). Returns
+//  false if an entire row is zero, leaving factors
+//  empty. The scaled and eliminated matrices are
+//  printed along the way if asked, and the image
+//  vector, unless NULL, is scaled and eliminated
+//  alongside the matrix.
+bool FactorMatrix(DenseMatrix& matrix, LUFactorization& factors, int threads, bool print,
+                  float* imageVector)
 {
-    // Multiplier for eliminating rows based on pivot
-    double multiplier;
+    factors.pivots = new int[matrix.rows];
+    factors.rowScales = new double[matrix.rows];
+    factors.lu = matrix;
+    matrix.data = NULL;
+    matrix.rows = matrix.columns = matrix.stride = 0;
 
-    // For every row in the matrix
-    for(int i = 0; i < matrixSize-1; ++i)
+    if(!ScaleRows(factors.lu, imageVector, factors.rowScales))
     {
-        //Pivot the column that must be eliminated
-        PartialPivot(matrix, matrixSize, i, imageVector);
-        //PrintMatrix(matrix, matrixSize, matrixSize);
+        DestroyFactorization(factors);
+        return false;
+    }
 
-        // For every row under the current row
-        for(int j = i + 1; j < matrixSize; ++j)
+    if(print)
+    {
+        cout << endl << endl << "SCALED MATRIX:" << endl;
+        PrintMatrix(factors.lu);
+
+        cout << endl << endl << "ELIMINATED MATRIX:" << endl;
+    }
+    BlockedLU(factors.lu, factors.pivots, threads, imageVector);
+    if(print)
+        PrintMatrix(factors.lu, true);
+
+    return true;
+}
+
+// SOLVE FACTORED:
+//  Overwrites the image vector with its preimage under
+//  a factored matrix.
+void SolveFactored(const LUFactorization& factors, float* imageVector)
+{
+    // Scale the image as its row of the matrix was scaled
+    for(int i = 0; i < factors.lu.rows; ++i)
+        imageVector[i] = double(imageVector[i])/factors.rowScales[i];
+
+    ForwardSubstitution(factors.lu, factors.pivots, imageVector);
+    BackSubstitution(factors.lu, imageVector);
+}
+
+// SOLVE FACTORED MANY:
+//  Overwrites every column of images, each an image
+//  vector, with its preimage under a factored matrix.
+void SolveFactoredMany(const LUFactorization& factors, DenseMatrix& images)
+{
+    for(int i = 0; i < images.rows; ++i)
+    {
+        float* row = images[i];
+        double scale = factors.rowScales[i];
+        for(int j = 0; j < images.columns; ++j)
+            row[j] = double(row[j])/scale;
+    }
+
+    ForwardSubstitution(factors.lu, factors.pivots, images);
+    BackSubstitution(factors.lu, images);
+}
+
+// DESTROY FACTORIZATION:
+//  Deallocates a factorization and leaves it empty.
+void DestroyFactorization(LUFactorization& factors)
+{
+    DestroyMatrix(factors.lu);
+    delete[] factors.pivots;
+    delete[] factors.rowScales;
+    factors.pivots = NULL;
+    factors.rowScales = NULL;
+}
+
+// REFINED SOLVE:
+//  Solves the system in double precision using the
+//  single precision factors of the matrix: the float
+//  solution is corrected with residuals computed in
+//  double against the original matrix until the
+//  normwise backward error reaches targetError or
+//  stops improving, keeping the best solution found.
+//  A target of 0 asks for the accuracy of double
+//  precision.
+RefinementReport RefinedSolve(const DoubleMatrix& matrix, const LUFactorization& factors,
+                              const double* imageVector, double* preimage, double targetError)
+{
+    int matrixSize = matrix.rows;
+    float* correction = new float[matrixSize];
+    double* residual = new double[matrixSize];
+    double* previousPreimage = new double[matrixSize];
+
+    if(targetError <= 0)
+        targetError = matrixSize*0.5*numeric_limits<double>::epsilon();
+
+    // The backward error is measured against the sizes of
+    // the matrix and the image
+    double matrixNorm = 0, imageNorm = 0;
+    for(int i = 0; i < matrixSize; ++i)
+    {
+        double rowSum = 0;
+        for(int j = 0; j < matrixSize; ++j)
+            rowSum += fabs(matrix[i][j]);
+        matrixNorm = max(matrixNorm, rowSum);
+        imageNorm = max(imageNorm, fabs(imageVector[i]));
+    }
+
+    // Start from the single precision solution
+    for(int i = 0; i < matrixSize; ++i)
+        correction[i] = imageVector[i];
+    SolveFactored(factors, correction);
+    for(int i = 0; i < matrixSize; ++i)
+        preimage[i] = correction[i];
+
+    RefinementReport report, previous;
+    report.steps = 0;
+    report.converged = false;
+    double previousError = HUGE_VAL;
+
+    while(true)
+    {
+        report.residualNorm = Residual(matrix, imageVector, preimage, residual);
+
+        double preimageNorm = 0;
+        for(int i = 0; i < matrixSize; ++i)
+            preimageNorm = max(preimageNorm, fabs(preimage[i]));
+
+        double scale = matrixNorm*preimageNorm + imageNorm;
+        report.backwardError = (scale > 0) ? report.residualNorm/scale : 0;
+
+        if(report.backwardError <= targetError)
         {
-            // Generate elimination multiplier so the item under
-            // matrix[i][i] is reduced to zero
-            multiplier = double(matrix[j][i])/double(matrix[i][i]);
+            report.converged = true;
+            break;
+        }
 
-            // For every item in the row
-            for(int k = i; k < matrixSize; ++k)
+        // Corrections that no longer halve the error are only
+        // adding noise, as are any past the step limit. One that
+        // made the error worse is undone.
+        if(report.backwardError > 0.5*previousError || report.steps == MAX_REFINEMENT_STEPS)
+        {
+            if(report.backwardError > previousError)
             {
-                // Row subtract the current row from each row under it
-                matrix[j][k] = double(matrix[j][k]) - (multiplier * double(matrix[i][k]));
+                copy(previousPreimage, previousPreimage + matrixSize, preimage);
+                report = previous;
             }
+            break;
+        }
+        previousError = report.backwardError;
+        previous = report;
+        copy(preimage, preimage + matrixSize, previousPreimage);
+
+        // Solve for the correction in single precision. The
+        // residual is scaled up first so it cannot underflow.
+        double residualScale = (report.residualNorm > 0) ? report.residualNorm : 1;
+        for(int i = 0; i < matrixSize; ++i)
+            correction[i] = residual[i]/residualScale;
+        SolveFactored(factors, correction);
+
+        for(int i = 0; i < matrixSize; ++i)
+            preimage[i] += residualScale*correction[i];
+        ++report.steps;
+    }
+
+    delete[] correction;
+    delete[] residual;
+    delete[] previousPreimage;
+
+    return report;
+}
+
+// RESIDUAL:
+//  Stores image - matrix * preimage in residual,
+//  accumulating in double, and returns its largest
+//  absolute entry.
+double Residual(const DoubleMatrix& matrix, const double* imageVector, const double* preimage, double* residual)
+{
+    double largest = 0;
+    for(int i = 0; i < matrix.rows; ++i)
+    {
+        const double* row = matrix[i];
+        double sum = imageVector[i];
+        for(int j = 0; j < matrix.columns; ++j)
+            sum -= row[j]*preimage[j];
+
+        residual[i] = sum;
+        largest = max(largest, fabs(sum));
+    }
+
+    return largest;
+}
+
+// SOLVE FACTORED TRANSPOSED:
+//  Overwrites the image vector with its preimage under
+//  the transpose of a factored matrix. The matrix is
+//  D P^T L U for the row scales D and the row swaps P,
+//  so its transpose is solved through U^T, then L^T,
+//  then the swaps undone in reverse, then D.
+void SolveFactoredTransposed(const LUFactorization& factors, float* imageVector)
+{
+    const DenseMatrix& lu = factors.lu;
+    int matrixSize = lu.rows;
+
+    // U^T is lower triangular, and each row of U holds the
+    // multiples of one solved item to subtract from the rest
+    for(int i = 0; i < matrixSize; ++i)
+    {
+        imageVector[i] /= lu[i][i];
+        SubtractMultiple(imageVector, lu[i], imageVector[i], i + 1, matrixSize);
+    }
+
+    // L^T is unit upper triangular, solved from the bottom up
+    for(int i = matrixSize - 1; i > 0; --i)
+        SubtractMultiple(imageVector, lu[i], imageVector[i], 0, i);
+
+    for(int i = matrixSize - 1; i >= 0; --i)
+        swap(imageVector[i], imageVector[factors.pivots[i]]);
+
+    for(int i = 0; i < matrixSize; ++i)
+        imageVector[i] = double(imageVector[i])/factors.rowScales[i];
+}
+
+// LOG DETERMINANT:
+//  Returns the natural log of the absolute value of
+//  the determinant of a factored matrix, which cannot
+//  overflow or underflow as the determinant itself can,
+//  and sets sign to the sign of the determinant (0 if
+//  the matrix is singular). The determinant is the
+//  product of the row scales and the diagonal of U,
+//  negated once for every row swap.
+double LogDeterminant(const LUFactorization& factors, int& sign)
+{
+    double logDeterminant = 0;
+    sign = 1;
 
-            imageVector[j] = double(imageVector[j]) - (multiplier * double(imageVector[i]));
+    for(int i = 0; i < factors.lu.rows; ++i)
+    {
+        float diagonal = factors.lu[i][i];
+        if(diagonal == 0)
+        {
+            sign = 0;
+            return -HUGE_VAL;
         }
+
+        if(diagonal < 0)
+            sign = -sign;
+        if(factors.pivots[i] != i)
+            sign = -sign;
+
+        logDeterminant += log(fabs(double(diagonal))) + log(factors.rowScales[i]);
     }
 
+    return logDeterminant;
 }
 
-// PARTIAL PIVOT
-//  Swaps rows in the matrix to ensure that there is
-//  no accidental zero or close-to-zero division during
-//  Gaussian elimination. Only used in Gaussian Elimination
-void PartialPivot(float** matrix, int matrixSize, int elimStep, float* imageVector)
+// ONE NORM:
+//  Returns the largest absolute column sum of a matrix.
+double OneNorm(const DenseMatrix& matrix)
 {
-    int maxIndex = elimStep;
-    for(int i = elimStep; i < matrixSize; ++i)
+    vector<double> columnSums(matrix.columns, 0.0);
+    for(int i = 0; i < matrix.rows; ++i)
+        for(int j = 0; j < matrix.columns; ++j)
+            columnSums[j] += fabs(matrix[i][j]);
+
+    double norm = 0;
+    for(int j = 0; j < matrix.columns; ++j)
+        norm = max(norm, columnSums[j]);
+
+    return norm;
+}
+
+// CONDITION ESTIMATE:
+//  Estimates the 1-norm condition number of a factored
+//  matrix, ||A|| ||A^-1||, given its 1-norm, from a few
+//  solves with its factors and their transpose in O(n^2)
+//  work. The estimate of ||A^-1|| is a lower bound,
+//  rarely more than a factor of 3 below it.
+//
+//  Hager's method climbs ||A^-1 x|| over the unit ball
+//  of the 1-norm: the sign vector of A^-1 x, solved
+//  against A^-T, points to the column of A^-1 most
+//  likely to be larger. Higham's refinements stop when
+//  the estimate or the signs stop changing, and check
+//  one extra alternating vector, which catches the
+//  matrices that mislead the climb.
+double ConditionEstimate(const LUFactorization& factors, double matrixNorm)
+{
+    int matrixSize = factors.lu.rows;
+    if(matrixSize == 0)
+        return 0;
+    for(int i = 0; i < matrixSize; ++i)
+        if(factors.lu[i][i] == 0)
+            return HUGE_VAL;
+
+    vector<float> x(matrixSize, 1.0f/matrixSize), y(matrixSize), signs(matrixSize, 0.0f);
+    double estimate = 0;
+
+    for(int iteration = 0; iteration < 5; ++iteration)
     {
-        if(absf(matrix[i][elimStep]) > absf(matrix[maxIndex][elimStep]))
-            maxIndex = i;
+        y = x;
+        SolveFactored(factors, y.data());
+
+        double norm = 0;
+        for(int i = 0; i < matrixSize; ++i)
+            norm += fabs(y[i]);
+        if(iteration > 0 && norm <= estimate)
+            break;
+        estimate = norm;
+
+        // Stop once the signs repeat, as the next step would too
+        bool repeated = true;
+        for(int i = 0; i < matrixSize; ++i)
+        {
+            float sign = (y[i] >= 0) ? 1.0f : -1.0f;
+            repeated = repeated && (sign == signs[i]);
+            signs[i] = sign;
+        }
+        if(repeated)
+            break;
+
+        y = signs;
+        SolveFactoredTransposed(factors, y.data());
+
+        int largest = 0;
+        double product = 0;
+        for(int i = 0; i < matrixSize; ++i)
+        {
+            if(fabs(y[i]) > fabs(y[largest]))
+                largest = i;
+            product += double(y[i])*x[i];
+        }
+        if(iteration > 0 && fabs(y[largest]) <= product)
+            break;
+
+        fill(x.begin(), x.end(), 0.0f);
+        x[largest] = 1;
     }
 
-    SwapRows(matrix, elimStep, maxIndex);
+    // The alternating vector (-1)^i (1 + i/(n-1))
+    for(int i = 0; i < matrixSize; ++i)
+        x[i] = ((i % 2) ? -1.0 : 1.0)*(1 + double(i)/max(1, matrixSize - 1));
+    SolveFactored(factors, x.data());
 
-    // Swap items on image vector
-    float temp = 0;
-    temp = imageVector[maxIndex];
-    imageVector[maxIndex] = imageVector[elimStep];
-    imageVector[elimStep] = temp;
+    double alternate = 0;
+    for(int i = 0; i < matrixSize; ++i)
+        alternate += fabs(x[i]);
+    estimate = max(estimate, 2*alternate/(3*matrixSize));
 
+    // Solutions that overflowed leave no estimate
+    if(!(estimate < HUGE_VAL))
+        return HUGE_VAL;
+
+    return matrixNorm*estimate;
 }
 
-// BACK SUBSTITUTION:
-//  Propagates back up through the upper-triangular matrix
-//  to calculate the preimage vector and stores in in
-//  the image vector
-void BackSubstitution(float** matrix, int matrixSize, float* imageVector)
+// INVERT FACTORED:
+//  Overwrites a factorization with the inverse of the
+//  matrix it factors, leaving the inverse in lu, after
+//  which it can no longer be solved against. Returns
+//  false, leaving the factors unchanged, if the matrix
+//  is singular. The matrix is D P^T L U, so its inverse
+//  is U^-1 L^-1 P D^-1: the columns of U^-1 L^-1 are
+//  swapped back in reverse and divided by the scales.
+bool InvertFactored(LUFactorization& factors)
 {
-    float sum;
+    DenseMatrix& lu = factors.lu;
+    int matrixSize = lu.rows;
 
-    //Find the first pre-image value
-    imageVector[matrixSize-1] = (imageVector[matrixSize-1])/(matrix[matrixSize-1][matrixSize-1]);
+    for(int i = 0; i < matrixSize; ++i)
+        if(lu[i][i] == 0)
+            return false;
 
-    // For every row
-    for(int i = matrixSize-2; i >= 0; --i)
+    InvertUpper(lu);
+    MultiplyInverseLower(lu);
+
+    for(int i = 0; i < matrixSize; ++i)
     {
-        sum = 0;
-        // For every item in the row already solved for
-        for(int j = i + 1; j < matrixSize; ++j)
-            sum += (matrix[i][j])*imageVector[j];
+        float* row = lu[i];
+        for(int j = matrixSize - 1; j >= 0; --j)
+            swap(row[j], row[factors.pivots[j]]);
+        for(int j = 0; j < matrixSize; ++j)
+            row[j] = double(row[j])/factors.rowScales[j];
+    }
 
-        // Subtract sum from image and divide by coefficient
-        imageVector[i] = (imageVector[i] - sum)/matrix[i][i];
+    return true;
+}
+
+// INVERT UPPER:
+//  Replaces the upper triangle U of a factored matrix
+//  with U^-1, a block of rows at a time from the bottom,
+//  leaving the multipliers below the diagonal.
+//
+//  With the rows below a block already inverted, the
+//  block's rows of U^-1 right of it are
+//  -U_block^-1 (U_right U^-1_below), and its diagonal
+//  block is U_block^-1. The block's rows of U are copied
+//  out first, as they are overwritten while still needed.
+//  The product is taken a tile of columns at a time so
+//  the rows of U^-1 it reads stay in cache.
+void InvertUpper(DenseMatrix& matrix)
+{
+    int matrixSize = matrix.rows;
+    DenseMatrix block = CreateMatrix(PANEL_WIDTH, matrixSize);
+
+    int blocks = (matrixSize + PANEL_WIDTH - 1)/PANEL_WIDTH;
+    for(int b = blocks - 1; b >= 0; --b)
+    {
+        int first = b*PANEL_WIDTH;
+        int last = min(first + PANEL_WIDTH, matrixSize);
+
+        for(int i = first; i < last; ++i)
+        {
+            copy(matrix[i] + i, matrix[i] + matrixSize, block[i - first] + i);
+            fill(matrix[i] + last, matrix[i] + matrixSize, 0.0f);
+        }
+
+        // Subtract U_right U^-1_below from the block's rows
+        for(int tile = last; tile < matrixSize; tile += TILE_COLUMNS)
+        {
+            int tileEnd = min(tile + TILE_COLUMNS, matrixSize);
+            for(int k = last; k < tileEnd; ++k)
+            {
+                const float* below = matrix[k];
+                for(int i = first; i < last; ++i)
+                    SubtractMultiple(matrix[i], below, block[i - first][k], max(k, tile), tileEnd);
+            }
+        }
+
+        // Solve against the block's diagonal block from the
+        // bottom up, first right of it, then within it
+        for(int i = last - 1; i >= first; --i)
+        {
+            float* row = matrix[i];
+            const float* original = block[i - first];
+            float diagonal = original[i];
+
+            for(int m = i + 1; m < last; ++m)
+                SubtractMultiple(row, matrix[m], original[m], last, matrixSize);
+            for(int j = last; j < matrixSize; ++j)
+                row[j] /= diagonal;
+
+            fill(row + i + 1, row + last, 0.0f);
+            for(int m = i + 1; m < last; ++m)
+                SubtractMultiple(row, matrix[m], original[m], m, last);
+            for(int j = i + 1; j < last; ++j)
+                row[j] /= diagonal;
+            row[i] = 1/diagonal;
+        }
     }
 
-    return;
+    DestroyMatrix(block);
+}
+
+// MULTIPLY INVERSE LOWER:
+//  Replaces a matrix holding U^-1 above and L below its
+//  diagonal with U^-1 L^-1, a block of columns at a time
+//  from the right.
+//
+//  Column j of X = U^-1 L^-1 is column j of U^-1 less
+//  the columns of X right of it times column j of L, so
+//  once the blocks right of a block are done, the block
+//  needs only its own columns of L. Those are copied out
+//  and cleared, then every row of the block's columns is
+//  updated a row of the copy at a time, tiles of the
+//  copy's rows staying in cache across all the rows.
+void MultiplyInverseLower(DenseMatrix& matrix)
+{
+    int matrixSize = matrix.rows;
+    DenseMatrix lower = CreateMatrix(matrixSize, PANEL_WIDTH);
+
+    int blocks = (matrixSize + PANEL_WIDTH - 1)/PANEL_WIDTH;
+    for(int b = blocks - 1; b >= 0; --b)
+    {
+        int first = b*PANEL_WIDTH;
+        int last = min(first + PANEL_WIDTH, matrixSize);
+        int width = last - first;
+
+        // Copy out and clear the block's columns of L
+        for(int m = first + 1; m < matrixSize; ++m)
+        {
+            int end = min(m, last);
+            fill(lower[m], lower[m] + width, 0.0f);
+            copy(matrix[m] + first, matrix[m] + end, lower[m]);
+            fill(matrix[m] + first, matrix[m] + end, 0.0f);
+        }
+
+        // Subtract the columns right of the block, a tile of rows of L at a time
+        for(int tile = last; tile < matrixSize; tile += TILE_COLUMNS)
+        {
+            int tileEnd = min(tile + TILE_COLUMNS, matrixSize);
+            for(int i = 0; i < matrixSize; ++i)
+            {
+                float* row = matrix[i] + first;
+                for(int m = tile; m < tileEnd; ++m)
+                    SubtractMultiple(row, lower[m], matrix[i][m], 0, width);
+            }
+        }
+
+        // Then the block's own columns, from the right
+        for(int i = 0; i < matrixSize; ++i)
+        {
+            float* row = matrix[i] + first;
+            for(int m = last - 1; m > first; --m)
+                SubtractMultiple(row, lower[m], matrix[i][m], 0, m - first);
+        }
+    }
+
+    DestroyMatrix(lower);
+}
+
+// BLOCKED LU:
+//  Factors the matrix in place into a unit lower-
+//  triangular L (below the diagonal) and an upper-
+//  triangular U, recording in pivots the row swapped
+//  into each row. Works a panel of columns at a time,
+//  on several threads if asked. The image vector is
+//  eliminated alongside the matrix unless it is NULL.
+void BlockedLU(DenseMatrix& matrix, int* pivots, int threads, float* imageVector)
+{
+    int matrixSize = matrix.rows;
+
+    if(threads > 1 && matrixSize > PANEL_WIDTH)
+    {
+        ParallelLU(matrix, pivots, threads, imageVector);
+        return;
+    }
+
+    // For every panel of columns
+    for(int first = 0; first < matrixSize; first += PANEL_WIDTH)
+    {
+        int width = min(PANEL_WIDTH, matrixSize - first);
+
+        // Eliminate the panel's columns with row operations
+        // confined to the panel, which stays in cache
+        FactorPanel(matrix, first, width, pivots, imageVector);
+
+        // Apply the whole panel to the rest of the matrix at once
+        UpdateTrailing(matrix, pivots, first, width, first + width, matrix.columns);
+    }
+
+    ApplyLeftSwaps(matrix, pivots);
+}
+
+// PARALLEL LU:
+//  Factors the matrix exactly as BlockedLU does, but
+//  runs the panel factorizations and the updates of
+//  each panel-wide block of columns as tasks on a pool
+//  of threads, starting each task once the tasks it
+//  depends on are done.
+//
+//  Block c must have every earlier panel applied to it
+//  before it is factored as panel c, and panel k must
+//  be factored before it is applied to any block. Ready
+//  panels are run first, then the updates of the oldest
+//  panel nearest the diagonal, so the next panel is
+//  factored while the other threads are still applying
+//  the previous one (lookahead). Every task does the
+//  same arithmetic as the serial factorization, so the
+//  results match it bit for bit.
+void ParallelLU(DenseMatrix& matrix, int* pivots, int threads, float* imageVector)
+{
+    int matrixSize = matrix.rows;
+    int blocks = (matrixSize + PANEL_WIDTH - 1)/PANEL_WIDTH;
+
+    mutex lock;
+    condition_variable ready;
+    vector<int> applied(blocks, 0);      // Panels applied to each block
+    vector<bool> busy(blocks, false);    // Whether a task is working on each block
+    int factored = 0;                    // Panels factored so far
+
+    auto work = [&]()
+    {
+        unique_lock<mutex> guard(lock);
+        while(true)
+        {
+            // Find the most urgent task whose dependencies are met
+            int panel = -1, block = -1;
+            if(factored < blocks && !busy[factored] && applied[factored] == factored)
+            {
+                panel = factored;
+                block = factored;
+            }
+            else
+            {
+                for(int c = factored; c < blocks && block < 0; ++c)
+                    if(!busy[c] && applied[c] < factored && applied[c] < c)
+                        block = c;
+            }
+
+            if(block < 0)
+            {
+                if(factored == blocks)
+                    break;
+                ready.wait(guard);
+                continue;
+            }
+
+            busy[block] = true;
+            guard.unlock();
+
+            if(panel >= 0)
+            {
+                int first = panel*PANEL_WIDTH;
+                FactorPanel(matrix, first, min(PANEL_WIDTH, matrixSize - first), pivots, imageVector);
+            }
+            else
+            {
+                int first = applied[block]*PANEL_WIDTH;
+                int columnBegin = block*PANEL_WIDTH;
+                UpdateTrailing(matrix, pivots, first, PANEL_WIDTH,
+                               columnBegin, min(columnBegin + PANEL_WIDTH, matrix.columns));
+            }
+
+            guard.lock();
+            busy[block] = false;
+            if(panel >= 0)
+                ++factored;
+            else
+                ++applied[block];
+            ready.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for(int t = 1; t < threads; ++t)
+        workers.emplace_back(work);
+    work();
+    for(thread& worker : workers)
+        worker.join();
+
+    ApplyLeftSwaps(matrix, pivots);
+}
+
+// FACTOR PANEL:
+//  Eliminates the columns [first, first+width) of the
+//  rows at and below first, pivoting as it goes. The
+//  image vector is eliminated alongside, unless NULL.
+//  Rows are subtracted in double precision, as the
+//  original elimination did, so a matrix that fits in
+//  one panel is eliminated exactly as it was. Panels
+//  are factored in order, so only one thread at a time
+//  touches the image vector.
+void FactorPanel(DenseMatrix& matrix, int first, int width, int* pivots, float* imageVector)
+{
+    int matrixSize = matrix.rows;
+    int last = first + width;
+
+    // For every column in the panel
+    for(int i = first; i < last; ++i)
+    {
+        // Pivot the column that must be eliminated. The rest
+        // of the rows are swapped by UpdateTrailing and
+        // ApplyLeftSwaps, so that other threads can keep
+        // working on them meanwhile.
+        pivots[i] = PartialPivot(matrix, i, imageVector, first, last);
+
+        const float* pivotRow = matrix[i];
+        float pivot = pivotRow[i];
+        if(pivot == 0)
+            continue;
+
+        // For every row under the current row
+        for(int j = i + 1; j < matrixSize; ++j)
+        {
+            float* row = matrix[j];
+
+            // Generate elimination multiplier so the item under
+            // the pivot is reduced to zero, and store it in its place
+            double multiplier = double(row[i])/double(pivot);
+            row[i] = multiplier;
+
+            // Row subtract the pivot row, within the panel only
+            for(int k = i + 1; k < last; ++k)
+                row[k] = double(row[k]) - (multiplier * double(pivotRow[k]));
+
+            if(imageVector != NULL)
+                imageVector[j] = double(imageVector[j]) - (multiplier * double(imageVector[i]));
+        }
+    }
+}
+
+// UPDATE TRAILING:
+//  Applies a factored panel to the columns
+//  [columnBegin, columnEnd) right of it: swaps their
+//  rows as the panel did, solves for their block of U
+//  and subtracts the panel's rank-width product from
+//  the rows below.
+void UpdateTrailing(DenseMatrix& matrix, const int* pivots, int first, int width,
+                    int columnBegin, int columnEnd)
+{
+    int matrixSize = matrix.rows;
+    int last = first + width;
+    if(columnBegin >= columnEnd)
+        return;
+
+    for(int i = first; i < last; ++i)
+        SwapRows(matrix, i, pivots[i], columnBegin, columnEnd);
+
+    // The panel rows right of the panel become U12 by
+    // solving with the panel's unit lower triangle
+    for(int i = first + 1; i < last; ++i)
+    {
+        float* row = matrix[i];
+        for(int p = first; p < i; ++p)
+            SubtractMultiple(row, matrix[p], row[p], columnBegin, columnEnd);
+    }
+
+    MultiplySubtract(matrix, first, width, last, matrixSize, columnBegin, columnEnd);
+}
+
+// APPLY LEFT SWAPS:
+//  Swaps the multipliers of every panel as the panels
+//  after it swapped their rows, once all are factored.
+void ApplyLeftSwaps(DenseMatrix& matrix, const int* pivots)
+{
+    for(int first = PANEL_WIDTH; first < matrix.rows; first += PANEL_WIDTH)
+    {
+        int last = min(first + PANEL_WIDTH, matrix.rows);
+        for(int i = first; i < last; ++i)
+            SwapRows(matrix, i, pivots[i], 0, first);
+    }
+}
+
+// MULTIPLY SUBTRACT:
+//  Subtracts the product of the given row and column
+//  ranges of the panel from the block of the trailing
+//  matrix they meet in, a tile at a time.
+void MultiplySubtract(DenseMatrix& matrix, int first, int width,
+                      int rowBegin, int rowEnd, int columnBegin, int columnEnd)
+{
+    // Tiles of columns keep the panel rows being read in cache
+    // while every trailing row is updated against them
+    for(int tile = columnBegin; tile < columnEnd; tile += TILE_COLUMNS)
+    {
+        int tileEnd = min(tile + TILE_COLUMNS, columnEnd);
+
+        int i = rowBegin;
+        for(; i + KERNEL_ROWS <= rowEnd; i += KERNEL_ROWS)
+        {
+            float* rows[KERNEL_ROWS];
+            for(int r = 0; r < KERNEL_ROWS; ++r)
+                rows[r] = matrix[i + r];
+
+            int k = tile;
+            for(; k + KERNEL_COLUMNS <= tileEnd; k += KERNEL_COLUMNS)
+            {
+                // Hold a KERNEL_ROWS by KERNEL_COLUMNS block in SIMD
+                // registers across the whole panel
+                FloatVector block[KERNEL_ROWS][KERNEL_VECTORS];
+                #pragma GCC unroll 16
+                for(int r = 0; r < KERNEL_ROWS; ++r)
+                    #pragma GCC unroll 16
+                    for(int v = 0; v < KERNEL_VECTORS; ++v)
+                        memcpy(&block[r][v], rows[r] + k + v*VECTOR_WIDTH, sizeof(FloatVector));
+
+                for(int p = first; p < first + width; ++p)
+                {
+                    FloatVector pivotRow[KERNEL_VECTORS];
+                    #pragma GCC unroll 16
+                    for(int v = 0; v < KERNEL_VECTORS; ++v)
+                        memcpy(&pivotRow[v], matrix[p] + k + v*VECTOR_WIDTH, sizeof(FloatVector));
+
+                    #pragma GCC unroll 16
+                    for(int r = 0; r < KERNEL_ROWS; ++r)
+                    {
+                        float multiplier = rows[r][p];
+                        #pragma GCC unroll 16
+                        for(int v = 0; v < KERNEL_VECTORS; ++v)
+                            block[r][v] -= multiplier*pivotRow[v];
+                    }
+                }
+
+                #pragma GCC unroll 16
+                for(int r = 0; r < KERNEL_ROWS; ++r)
+                    #pragma GCC unroll 16
+                    for(int v = 0; v < KERNEL_VECTORS; ++v)
+                        memcpy(rows[r] + k + v*VECTOR_WIDTH, &block[r][v], sizeof(FloatVector));
+            }
+
+            // Columns left over at the end of the tile
+            for(int r = 0; r < KERNEL_ROWS; ++r)
+                for(int p = first; p < first + width; ++p)
+                {
+                    float multiplier = rows[r][p];
+                    const float* pivotRow = matrix[p];
+                    for(int c = k; c < tileEnd; ++c)
+                        rows[r][c] -= multiplier*pivotRow[c];
+                }
+        }
+
+        // Rows left over at the end of the matrix
+        for(; i < rowEnd; ++i)
+        {
+            float* row = matrix[i];
+            for(int p = first; p < first + width; ++p)
+            {
+                float multiplier = row[p];
+                const float* pivotRow = matrix[p];
+                for(int c = tile; c < tileEnd; ++c)
+                    row[c] -= multiplier*pivotRow[c];
+            }
+        }
+    }
+}
+
+// SUBTRACT MULTIPLE:
+//  Subtracts multiplier times source from target over
+//  the items [begin, end), a SIMD vector at a time.
+void SubtractMultiple(float* target, const float* source, float multiplier, int begin, int end)
+{
+    int k = begin;
+    for(; k + VECTOR_WIDTH <= end; k += VECTOR_WIDTH)
+    {
+        FloatVector items, sources;
+        memcpy(&items, target + k, sizeof(FloatVector));
+        memcpy(&sources, source + k, sizeof(FloatVector));
+        items -= multiplier*sources;
+        memcpy(target + k, &items, sizeof(FloatVector));
+    }
+
+    // Items left over after the last whole vector
+    for(; k < end; ++k)
+        target[k] -= multiplier*source[k];
+}
+
+// PARTIAL PIVOT
+//  Swaps rows in the matrix to ensure that there is
+//  no accidental zero or close-to-zero division during
+//  Gaussian elimination. Only used in Gaussian Elimination.
+//  Returns the row swapped in, and swaps the image
+//  vector alongside the matrix unless it is NULL.
+int PartialPivot(DenseMatrix& matrix, int elimStep, float* imageVector,
+                 int firstColumn, int lastColumn)
+{
+    int maxIndex = elimStep;
+    for(int i = elimStep; i < matrix.rows; ++i)
+    {
+        if(absf(matrix[i][elimStep]) > absf(matrix[maxIndex][elimStep]))
+            maxIndex = i;
+    }
+
+    SwapRows(matrix, elimStep, maxIndex, firstColumn, lastColumn);
+
+    // Swap items on image vector
+    if(imageVector != NULL)
+    {
+        float temp = 0;
+        temp = imageVector[maxIndex];
+        imageVector[maxIndex] = imageVector[elimStep];
+        imageVector[elimStep] = temp;
+    }
+
+    return maxIndex;
+}
+
+// FORWARD SUBSTITUTION:
+//  Applies the row swaps and the unit lower-triangular
+//  factor to the image vector, eliminating it as
+//  Gaussian elimination would have.
+void ForwardSubstitution(const DenseMatrix& matrix, const int* pivots, float* imageVector)
+{
+    int matrixSize = matrix.rows;
+
+    // Swap image entries in the order the rows were swapped
+    for(int i = 0; i < matrixSize; ++i)
+        swap(imageVector[i], imageVector[pivots[i]]);
+
+    // For every row, subtract the multiples of the rows above it
+    for(int i = 1; i < matrixSize; ++i)
+    {
+        const float* row = matrix[i];
+        double sum = 0;
+        for(int j = 0; j < i; ++j)
+            sum += double(row[j])*imageVector[j];
+
+        imageVector[i] = double(imageVector[i]) - sum;
+    }
+}
+
+// BACK SUBSTITUTION:
+//  Propagates back up through the upper-triangular matrix
+//  to calculate the preimage vector and stores in in
+//  the image vector
+void BackSubstitution(const DenseMatrix& matrix, float* imageVector)
+{
+    int matrixSize = matrix.rows;
+    float sum;
+
+    //Find the first pre-image value
+    imageVector[matrixSize-1] = (imageVector[matrixSize-1])/(matrix[matrixSize-1][matrixSize-1]);
+
+    // For every row
+    for(int i = matrixSize-2; i >= 0; --i)
+    {
+        const float* row = matrix[i];
+        sum = 0;
+        // For every item in the row already solved for
+        for(int j = i + 1; j < matrixSize; ++j)
+            sum += (row[j])*imageVector[j];
+
+        // Subtract sum from image and divide by coefficient
+        imageVector[i] = (imageVector[i] - sum)/row[i];
+    }
+
+    return;
+}
+
+// FORWARD SUBSTITUTION MANY:
+//  Forward substitution for every column of images
+//  at once.
+void ForwardSubstitution(const DenseMatrix& matrix, const int* pivots, DenseMatrix& images)
+{
+    int matrixSize = matrix.rows;
+
+    // Swap image rows in the order the rows were swapped
+    for(int i = 0; i < matrixSize; ++i)
+        SwapRows(images, i, pivots[i]);
+
+    // Tiles of columns keep the rows of images being
+    // subtracted in cache while every row is reduced
+    for(int tile = 0; tile < images.columns; tile += TILE_COLUMNS)
+    {
+        int tileEnd = min(tile + TILE_COLUMNS, images.columns);
+
+        // For every row, subtract the multiples of the rows above it
+        for(int i = 1; i < matrixSize; ++i)
+        {
+            const float* row = matrix[i];
+            float* image = images[i];
+            for(int j = 0; j < i; ++j)
+                SubtractMultiple(image, images[j], row[j], tile, tileEnd);
+        }
+    }
+}
+
+// BACK SUBSTITUTION MANY:
+//  Back substitution for every column of images at
+//  once, the rows of images being updated as whole
+//  vectors.
+void BackSubstitution(const DenseMatrix& matrix, DenseMatrix& images)
+{
+    int matrixSize = matrix.rows;
+
+    for(int tile = 0; tile < images.columns; tile += TILE_COLUMNS)
+    {
+        int tileEnd = min(tile + TILE_COLUMNS, images.columns);
+
+        // For every row, from the bottom up
+        for(int i = matrixSize - 1; i >= 0; --i)
+        {
+            const float* row = matrix[i];
+            float* image = images[i];
+
+            // Subtract every preimage row already solved for
+            for(int j = i + 1; j < matrixSize; ++j)
+                SubtractMultiple(image, images[j], row[j], tile, tileEnd);
+
+            // Divide by the coefficient on the diagonal
+            float diagonal = row[i];
+            for(int k = tile; k < tileEnd; ++k)
+                image[k] /= diagonal;
+        }
+    }
+}
+
+// SOLVE SPARSE INPUT:
+//  Reads a system given as its nonzero items and
+//  solves it, along with any further image vectors,
+//  by the path its structure suits best. Without
+//  prompts, as in quiet mode, the input is read at
+//  once and only the solutions are printed.
+int SolveSparseInput(int threads, bool quiet)
+{
+    // Variables to store any user input
+    int ROWS = 0, COLUMNS = 0;
+    long ITEMS = -1;
+
+    // Reads the next number typed or given as text
+    TextInput text;
+    if(quiet)
+        ReadTextInput(text);
+    auto read = [&](auto& number) -> bool
+    {
+        if(quiet)
+            return ReadNumber(text, number);
+        return bool(cin >> number);
+    };
+
+    // Prompt user for matrix size
+    if(!quiet)
+        cout << "How many rows, columns and nonzero items: ";
+    read(ROWS) && read(COLUMNS) && read(ITEMS);
+
+    if( ROWS != COLUMNS )
+    {
+        cerr << "ERROR: Matrix not invertible. This system only solves square matrices." << endl;
+        return -1;
+    }
+    if(ROWS < 1 || ITEMS < 0)
+    {
+        cerr << "ERROR: The matrix size and number of items were not given." << endl;
+        return -1;
+    }
+
+    // Prompt user for the items, in any order
+    if(!quiet)
+        cout << "Input the nonzero items as row, column and value, counting from 0: " << endl;
+
+    vector<int> rowIndices(ITEMS), columnIndices(ITEMS);
+    vector<float> values(ITEMS);
+    for(long k = 0; k < ITEMS; ++k)
+    {
+        if(!(read(rowIndices[k]) && read(columnIndices[k]) && read(values[k])))
+        {
+            cerr << "ERROR: Fewer items were given than promised." << endl;
+            return -1;
+        }
+        if(rowIndices[k] < 0 || rowIndices[k] >= ROWS || columnIndices[k] < 0 || columnIndices[k] >= COLUMNS)
+        {
+            cerr << "ERROR: Item " << k << " lies outside the matrix." << endl;
+            return -1;
+        }
+    }
+
+    // Reads an image vector, returning false unless all of it was given
+    float* imageVector = new float[ROWS];
+    auto readImage = [&]() -> bool
+    {
+        for(int i = 0; i < ROWS; ++i)
+            if(!read(imageVector[i]))
+                return false;
+        return true;
+    };
+
+    if(!quiet)
+        cout << "Input the image vector:" << endl;
+
+    if(!readImage())
+    {
+        cerr << "ERROR: No complete image vector was given." << endl;
+        delete[] imageVector;
+        return -1;
+    }
+
+    SparseMatrix matrix = CreateSparseMatrix(ROWS, COLUMNS, rowIndices, columnIndices, values);
+
+    StructuredFactorization factors;
+    if(!FactorStructured(matrix, factors, threads))
+    {
+        delete[] imageVector;
+        if(factors.path == DENSE_PATH && ROWS > MAX_DENSE_ROWS)
+        {
+            cerr << "ERROR: No narrow band was found, and matrices of more than " << MAX_DENSE_ROWS
+                 << " rows are too large to solve densely." << endl;
+            return -1;
+        }
+
+        cout << endl << endl << "The matrix does not have a unique solution." << endl;
+        return 0;
+    }
+
+    // Report the structure found and the path it chose
+    if(!quiet)
+    {
+        static const char* pathNames[] = { "TRIDIAGONAL (THOMAS ALGORITHM)", "BAND LU",
+                                           "BAND LU AFTER REVERSE CUTHILL-MCKEE ORDERING", "DENSE LU" };
+        int lower, upper;
+        Bandwidths(matrix, lower, upper);
+        cout << endl << endl << "STRUCTURE: " << matrix.values.size() << " nonzero items, "
+             << lower << " diagonals below and " << upper << " above" << endl;
+        cout << "SOLVER: " << pathNames[factors.path];
+        if(factors.path == BAND_PATH || factors.path == REORDERED_BAND_PATH)
+            cout << " (" << factors.band.lower << " diagonals below and " << factors.band.upper << " above)";
+        cout << endl;
+    }
+
+    // Solve the first image vector, then every further one given
+    do
+    {
+        SolveStructured(factors, imageVector);
+
+        cout << endl << endl << "SOLUTION VECTOR:" << endl;
+        for(int i = 0; i < ROWS; ++i)
+            cout << imageVector[i] << '\n';
+        cout << flush;
+    }
+    while(readImage());
+
+    DestroyStructured(factors);
+    delete[] imageVector;
+
+    return 0;
+}
+
+// CREATE SPARSE MATRIX:
+//  Builds a sparse matrix from (row, column, value)
+//  items in any order, summing repeated items and
+//  dropping zeros.
+SparseMatrix CreateSparseMatrix(int rows, int columns, const vector<int>& rowIndices,
+                                const vector<int>& columnIndices, const vector<float>& values)
+{
+    SparseMatrix matrix;
+    matrix.rows = rows;
+    matrix.columns = columns;
+
+    // Count the items of each row, then place them
+    vector<int> starts(rows + 1, 0);
+    for(size_t k = 0; k < rowIndices.size(); ++k)
+        ++starts[rowIndices[k] + 1];
+    for(int i = 0; i < rows; ++i)
+        starts[i + 1] += starts[i];
+
+    vector<pair<int, double> > items(rowIndices.size());
+    vector<int> next(starts.begin(), starts.end() - 1);
+    for(size_t k = 0; k < rowIndices.size(); ++k)
+        items[next[rowIndices[k]]++] = make_pair(columnIndices[k], double(values[k]));
+
+    // Sort each row by column and sum the repeats
+    matrix.rowStarts.assign(1, 0);
+    matrix.columnIndices.reserve(items.size());
+    matrix.values.reserve(items.size());
+    for(int i = 0; i < rows; ++i)
+    {
+        sort(items.begin() + starts[i], items.begin() + starts[i + 1]);
+        for(int k = starts[i]; k < starts[i + 1]; )
+        {
+            int column = items[k].first;
+            double sum = 0;
+            for(; k < starts[i + 1] && items[k].first == column; ++k)
+                sum += items[k].second;
+
+            if(sum != 0)
+            {
+                matrix.columnIndices.push_back(column);
+                matrix.values.push_back(sum);
+            }
+        }
+        matrix.rowStarts.push_back(matrix.values.size());
+    }
+
+    return matrix;
+}
+
+// SCALE SPARSE ROWS:
+//  Scales each row of a sparse matrix as ScaleRows
+//  does, keeping the divisors in rowScales. Returns
+//  false if an entire row is zero.
+bool ScaleRows(SparseMatrix& matrix, double* rowScales)
+{
+    for(int i = 0; i < matrix.rows; ++i)
+    {
+        // Find maximum absolute value
+        double rowMaxAbs = 0;
+        for(int k = matrix.rowStarts[i]; k < matrix.rowStarts[i + 1]; ++k)
+            rowMaxAbs = max(rowMaxAbs, double(absf(matrix.values[k])));
+
+        // If an entire row is zero
+        if(rowMaxAbs == 0)
+            return false;
+
+        for(int k = matrix.rowStarts[i]; k < matrix.rowStarts[i + 1]; ++k)
+            matrix.values[k] = double(matrix.values[k])/rowMaxAbs;
+        rowScales[i] = rowMaxAbs;
+    }
+
+    return true;
+}
+
+// BANDWIDTHS:
+//  Finds how many diagonals below and above the main
+//  one hold nonzero items.
+void Bandwidths(const SparseMatrix& matrix, int& lower, int& upper)
+{
+    lower = upper = 0;
+    for(int i = 0; i < matrix.rows; ++i)
+    {
+        // Columns are sorted, so the first and last items are the farthest out
+        if(matrix.rowStarts[i] == matrix.rowStarts[i + 1])
+            continue;
+        lower = max(lower, i - matrix.columnIndices[matrix.rowStarts[i]]);
+        upper = max(upper, matrix.columnIndices[matrix.rowStarts[i + 1] - 1] - i);
+    }
+}
+
+// DIAGONALLY DOMINANT:
+//  Whether every diagonal item is at least as large as
+//  the rest of its row together, in which case the
+//  matrix is factored stably without pivoting.
+bool DiagonallyDominant(const SparseMatrix& matrix)
+{
+    for(int i = 0; i < matrix.rows; ++i)
+    {
+        double diagonal = 0, others = 0;
+        for(int k = matrix.rowStarts[i]; k < matrix.rowStarts[i + 1]; ++k)
+        {
+            if(matrix.columnIndices[k] == i)
+                diagonal = fabs(matrix.values[k]);
+            else
+                others += fabs(matrix.values[k]);
+        }
+
+        if(diagonal < others)
+            return false;
+    }
+
+    return true;
+}
+
+// REVERSE CUTHILL MCKEE:
+//  Orders the rows and columns of a matrix so that its
+//  nonzero items cluster near the diagonal: a breadth
+//  first search of the graph of A + A^T from a node far
+//  from the rest, visiting neighbors by increasing
+//  degree, reversed. order[k] is the original index
+//  placed k-th.
+void ReverseCuthillMcKee(const SparseMatrix& matrix, int* order)
+{
+    int matrixSize = matrix.rows;
+
+    // Neighbors of every node in the graph of A + A^T
+    vector<int> starts(matrixSize + 1, 0);
+    for(int i = 0; i < matrixSize; ++i)
+        for(int k = matrix.rowStarts[i]; k < matrix.rowStarts[i + 1]; ++k)
+            if(matrix.columnIndices[k] != i)
+            {
+                ++starts[i + 1];
+                ++starts[matrix.columnIndices[k] + 1];
+            }
+    for(int i = 0; i < matrixSize; ++i)
+        starts[i + 1] += starts[i];
+
+    vector<int> neighbors(starts[matrixSize]);
+    vector<int> next(starts.begin(), starts.end() - 1);
+    for(int i = 0; i < matrixSize; ++i)
+        for(int k = matrix.rowStarts[i]; k < matrix.rowStarts[i + 1]; ++k)
+        {
+            int j = matrix.columnIndices[k];
+            if(j != i)
+            {
+                neighbors[next[i]++] = j;
+                neighbors[next[j]++] = i;
+            }
+        }
+
+    // An item and its transpose both add the same edge, so
+    // drop the repeats; next then marks the end of each list
+    vector<int> degree(matrixSize);
+    for(int i = 0; i < matrixSize; ++i)
+    {
+        sort(neighbors.begin() + starts[i], neighbors.begin() + next[i]);
+        next[i] = unique(neighbors.begin() + starts[i], neighbors.begin() + next[i]) - neighbors.begin();
+        degree[i] = next[i] - starts[i];
+    }
+
+    // Breadth first search from root over unplaced nodes, writing
+    // the nodes reached to order from position first and returning
+    // the position after the last. Each node's unplaced neighbors
+    // are visited by increasing degree. Nodes are marked with the
+    // stamp of the search that reached them, and the number of
+    // levels below the root and where the last one starts are kept.
+    vector<int> mark(matrixSize, -1);
+    vector<bool> placed(matrixSize, false);
+    int stamp = 0;
+    auto search = [&](int root, int first, int& depth, int& lastLevel)
+    {
+        ++stamp;
+        int end = first;
+        order[end++] = root;
+        mark[root] = stamp;
+        depth = 0;
+        lastLevel = first;
+
+        for(int head = first; true; )
+        {
+            int levelEnd = end;
+            for(; head < levelEnd; ++head)
+            {
+                int node = order[head], reached = end;
+                for(int k = starts[node]; k < next[node]; ++k)
+                {
+                    int j = neighbors[k];
+                    if(!placed[j] && mark[j] != stamp)
+                    {
+                        mark[j] = stamp;
+                        order[end++] = j;
+                    }
+                }
+                sort(order + reached, order + end, [&](int a, int b) { return degree[a] < degree[b]; });
+            }
+
+            if(end == levelEnd)
+                break;
+            ++depth;
+            lastLevel = levelEnd;
+        }
+        return end;
+    };
+
+    // Nodes by increasing degree, so each new component
+    // starts from its least connected node
+    vector<int> byDegree(matrixSize);
+    for(int i = 0; i < matrixSize; ++i)
+        byDegree[i] = i;
+    stable_sort(byDegree.begin(), byDegree.end(), [&](int a, int b) { return degree[a] < degree[b]; });
+
+    int placedCount = 0;
+    for(int candidate : byDegree)
+    {
+        if(placed[candidate])
+            continue;
+
+        // Move the root to the least connected node of the last level
+        // while that deepens the search, reaching a node at nearly the
+        // greatest distance from the rest, whose levels are narrow
+        int root = candidate, depth, lastLevel;
+        int end = search(root, placedCount, depth, lastLevel);
+        for(int tries = 0; tries < 8; ++tries)
+        {
+            int farthest = order[lastLevel];
+            for(int k = lastLevel + 1; k < end; ++k)
+                if(degree[order[k]] < degree[farthest])
+                    farthest = order[k];
+
+            int farDepth, farLastLevel;
+            search(farthest, placedCount, farDepth, farLastLevel);
+            if(farDepth <= depth)
+            {
+                search(root, placedCount, depth, lastLevel);
+                break;
+            }
+            root = farthest;
+            depth = farDepth;
+            lastLevel = farLastLevel;
+        }
+
+        for(int k = placedCount; k < end; ++k)
+            placed[order[k]] = true;
+        placedCount = end;
+    }
+
+    reverse(order, order + matrixSize);
+}
+
+// PERMUTE SYMMETRIC:
+//  Reorders both the rows and the columns of a matrix,
+//  row and column k of the result being row and column
+//  order[k] of the matrix.
+SparseMatrix PermuteSymmetric(const SparseMatrix& matrix, const int* order)
+{
+    int matrixSize = matrix.rows;
+    vector<int> position(matrixSize);
+    for(int k = 0; k < matrixSize; ++k)
+        position[order[k]] = k;
+
+    SparseMatrix permuted;
+    permuted.rows = permuted.columns = matrixSize;
+    permuted.rowStarts.assign(1, 0);
+    permuted.columnIndices.reserve(matrix.values.size());
+    permuted.values.reserve(matrix.values.size());
+
+    vector<pair<int, float> > row;
+    for(int k = 0; k < matrixSize; ++k)
+    {
+        int i = order[k];
+        row.clear();
+        for(int n = matrix.rowStarts[i]; n < matrix.rowStarts[i + 1]; ++n)
+            row.push_back(make_pair(position[matrix.columnIndices[n]], matrix.values[n]));
+        sort(row.begin(), row.end());
+
+        for(size_t n = 0; n < row.size(); ++n)
+        {
+            permuted.columnIndices.push_back(row[n].first);
+            permuted.values.push_back(row[n].second);
+        }
+        permuted.rowStarts.push_back(permuted.values.size());
+    }
+
+    return permuted;
+}
+
+// CREATE BAND MATRIX:
+//  Copies a sparse matrix into band storage with the
+//  given bandwidths, which must hold all its items.
+BandMatrix CreateBandMatrix(const SparseMatrix& matrix, int lower, int upper)
+{
+    BandMatrix band;
+    band.size = matrix.rows;
+    band.lower = lower;
+    band.upper = upper;
+    band.width = lower + upper + lower + 1;
+    band.data = new float[size_t(band.size)*band.width]();
+
+    for(int i = 0; i < matrix.rows; ++i)
+    {
+        float* row = band[i];
+        for(int k = matrix.rowStarts[i]; k < matrix.rowStarts[i + 1]; ++k)
+            row[matrix.columnIndices[k]] = matrix.values[k];
+    }
+
+    return band;
+}
+
+// DESTROY BAND MATRIX:
+//  Deallocates a band matrix and leaves it empty.
+void DestroyBandMatrix(BandMatrix& band)
+{
+    delete[] band.data;
+    band.data = NULL;
+    band.size = band.lower = band.upper = band.width = 0;
+}
+
+// THOMAS FACTOR:
+//  Factors a tridiagonal band matrix in place without
+//  pivoting. Returns false on a zero pivot. Each
+//  multiplier replaces the item below the diagonal it
+//  eliminated.
+bool ThomasFactor(BandMatrix& band)
+{
+    for(int i = 1; i < band.size; ++i)
+    {
+        float* above = band[i - 1];
+        float* row = band[i];
+        if(above[i - 1] == 0)
+            return false;
+
+        float multiplier = row[i - 1]/above[i - 1];
+        row[i - 1] = multiplier;
+        row[i] -= multiplier*above[i];
+    }
+
+    return band.size == 0 || band[band.size - 1][band.size - 1] != 0;
+}
+
+// THOMAS SOLVE:
+//  Overwrites the image vector with its preimage under
+//  a tridiagonal matrix factored by ThomasFactor.
+void ThomasSolve(const BandMatrix& band, float* imageVector)
+{
+    int matrixSize = band.size;
+    if(matrixSize == 0)
+        return;
+
+    // Eliminate the image as the rows were
+    for(int i = 1; i < matrixSize; ++i)
+        imageVector[i] -= band[i][i - 1]*imageVector[i - 1];
+
+    // Substitute back up the two diagonals of U
+    imageVector[matrixSize - 1] /= band[matrixSize - 1][matrixSize - 1];
+    for(int i = matrixSize - 2; i >= 0; --i)
+    {
+        const float* row = band[i];
+        imageVector[i] = (imageVector[i] - row[i + 1]*imageVector[i + 1])/row[i];
+    }
+}
+
+// BAND LU:
+//  Factors a band matrix in place with partial
+//  pivoting, recording the row swapped into each row
+//  in pivots. Only rows within the lower bandwidth are
+//  candidates, and U gains at most lower diagonals.
+//  Returns false if a column has no nonzero pivot.
+//  Rows are only swapped right of the column being
+//  eliminated, so each multiplier stays in the row it
+//  was computed for and BandSolve applies the swaps and
+//  multipliers in the same interleaved order.
+bool BandLU(BandMatrix& band, int* pivots)
+{
+    int matrixSize = band.size;
+    int reach = band.lower + band.upper;
+
+    for(int k = 0; k < matrixSize; ++k)
+    {
+        int last = min(k + band.lower, matrixSize - 1);
+        int end = min(k + reach, matrixSize - 1) + 1;
+
+        // Find the largest candidate in the column
+        int pivotRow = k;
+        float largest = absf(band[k][k]);
+        for(int i = k + 1; i <= last; ++i)
+        {
+            if(absf(band[i][k]) > largest)
+            {
+                largest = absf(band[i][k]);
+                pivotRow = i;
+            }
+        }
+
+        pivots[k] = pivotRow;
+        if(largest == 0)
+            return false;
+
+        if(pivotRow != k)
+            swap_ranges(band[k] + k, band[k] + end, band[pivotRow] + k);
+
+        // Eliminate the column from the rows below
+        const float* pivot = band[k];
+        for(int i = k + 1; i <= last; ++i)
+        {
+            float* row = band[i];
+            float multiplier = row[k]/pivot[k];
+            row[k] = multiplier;
+            if(multiplier != 0)
+                SubtractMultiple(row, pivot, multiplier, k + 1, end);
+        }
+    }
+
+    return true;
+}
+
+// BAND SOLVE:
+//  Overwrites the image vector with its preimage under
+//  a band matrix factored by BandLU.
+void BandSolve(const BandMatrix& band, const int* pivots, float* imageVector)
+{
+    int matrixSize = band.size;
+    int reach = band.lower + band.upper;
+
+    // Swap and eliminate the image as the rows were
+    for(int k = 0; k < matrixSize; ++k)
+    {
+        swap(imageVector[k], imageVector[pivots[k]]);
+
+        int last = min(k + band.lower, matrixSize - 1);
+        for(int i = k + 1; i <= last; ++i)
+            imageVector[i] -= band[i][k]*imageVector[k];
+    }
+
+    // Substitute back up through U
+    for(int i = matrixSize - 1; i >= 0; --i)
+    {
+        const float* row = band[i];
+        int end = min(i + reach, matrixSize - 1);
+
+        double sum = imageVector[i];
+        for(int j = i + 1; j <= end; ++j)
+            sum -= row[j]*imageVector[j];
+        imageVector[i] = sum/row[i];
+    }
+}
+
+// FACTOR STRUCTURED:
+//  Scales and factors a sparse matrix by the cheapest
+//  path: the Thomas algorithm for diagonally dominant
+//  tridiagonal matrices, otherwise band LU in the given
+//  order or after reordering, or dense LU when neither
+//  band is narrow enough to save work. Returns false
+//  if the matrix is singular, or needs dense LU but has
+//  more than MAX_DENSE_ROWS rows, leaving factors empty.
+//  The work of each path is counted in multiply-adds:
+//  size * lower * (lower + upper + 1) for band LU, and
+//  size^3 / 3 for dense LU.
+bool FactorStructured(const SparseMatrix& matrix, StructuredFactorization& factors, int threads)
+{
+    int matrixSize = matrix.rows;
+
+    factors.size = matrixSize;
+    factors.band.data = NULL;
+    factors.pivots = NULL;
+    factors.order = NULL;
+    factors.rowScales = new double[matrixSize];
+    factors.dense.lu.data = NULL;
+    factors.dense.pivots = NULL;
+    factors.dense.rowScales = NULL;
+
+    SparseMatrix scaled = matrix;
+    if(!ScaleRows(scaled, factors.rowScales))
+    {
+        DestroyStructured(factors);
+        return false;
+    }
+
+    int lower, upper;
+    Bandwidths(scaled, lower, upper);
+
+    bool factored;
+    if(lower <= 1 && upper <= 1 && DiagonallyDominant(scaled))
+    {
+        // Diagonal dominance keeps elimination stable without
+        // pivoting, leaving a tridiagonal U
+        factors.path = THOMAS_PATH;
+        factors.band = CreateBandMatrix(scaled, 1, 1);
+        factored = ThomasFactor(factors.band);
+    }
+    else
+    {
+        double denseWork = double(matrixSize)*matrixSize*matrixSize/3;
+        double bandWork = double(matrixSize)*lower*(lower + upper + 1);
+
+        // Reordering may narrow a band, or find one in a matrix
+        // whose items are scattered, but only when most of the
+        // band is zeros
+        vector<int> order;
+        SparseMatrix reordered;
+        int reorderedLower = lower, reorderedUpper = upper;
+        double reorderedWork = bandWork;
+        if(double(matrixSize)*(lower + upper + 1) > 2.0*scaled.values.size())
+        {
+            order.resize(matrixSize);
+            ReverseCuthillMcKee(scaled, order.data());
+            reordered = PermuteSymmetric(scaled, order.data());
+            Bandwidths(reordered, reorderedLower, reorderedUpper);
+            reorderedWork = double(matrixSize)*reorderedLower*(reorderedLower + reorderedUpper + 1);
+        }
+
+        if(min(bandWork, reorderedWork) < denseWork)
+        {
+            factors.path = BAND_PATH;
+            if(reorderedWork < bandWork)
+            {
+                factors.path = REORDERED_BAND_PATH;
+                factors.order = new int[matrixSize];
+                copy(order.begin(), order.end(), factors.order);
+                scaled = reordered;
+                lower = reorderedLower;
+                upper = reorderedUpper;
+            }
+
+            factors.band = CreateBandMatrix(scaled, lower, upper);
+            factors.pivots = new int[matrixSize];
+            factored = BandLU(factors.band, factors.pivots);
+        }
+        else
+        {
+            // Matrices too large to hold densely are refused
+            // rather than allocating every zero
+            factors.path = DENSE_PATH;
+            if(matrixSize > MAX_DENSE_ROWS)
+            {
+                DestroyStructured(factors);
+                return false;
+            }
+
+            factors.dense.lu = CreateMatrix(matrixSize, matrixSize);
+            factors.dense.pivots = new int[matrixSize];
+            for(int i = 0; i < matrixSize; ++i)
+                for(int k = scaled.rowStarts[i]; k < scaled.rowStarts[i + 1]; ++k)
+                    factors.dense.lu[i][scaled.columnIndices[k]] = scaled.values[k];
+
+            BlockedLU(factors.dense.lu, factors.dense.pivots, threads);
+
+            // A zero on the diagonal of U leaves no unique solution
+            factored = true;
+            for(int i = 0; i < matrixSize; ++i)
+                if(factors.dense.lu[i][i] == 0)
+                    factored = false;
+        }
+    }
+
+    if(!factored)
+        DestroyStructured(factors);
+    return factored;
+}
+
+// SOLVE STRUCTURED:
+//  Overwrites the image vector with its preimage under
+//  a matrix factored by FactorStructured.
+void SolveStructured(const StructuredFactorization& factors, float* imageVector)
+{
+    int matrixSize = factors.size;
+
+    // Scale the image as its row of the matrix was scaled
+    for(int i = 0; i < matrixSize; ++i)
+        imageVector[i] = double(imageVector[i])/factors.rowScales[i];
+
+    // Reorder the image as the rows were
+    float* image = imageVector;
+    if(factors.order != NULL)
+    {
+        image = new float[matrixSize];
+        for(int k = 0; k < matrixSize; ++k)
+            image[k] = imageVector[factors.order[k]];
+    }
+
+    switch(factors.path)
+    {
+        case THOMAS_PATH:
+            ThomasSolve(factors.band, image);
+            break;
+
+        case BAND_PATH:
+        case REORDERED_BAND_PATH:
+            BandSolve(factors.band, factors.pivots, image);
+            break;
+
+        case DENSE_PATH:
+            ForwardSubstitution(factors.dense.lu, factors.dense.pivots, image);
+            BackSubstitution(factors.dense.lu, image);
+            break;
+    }
+
+    // The preimage comes out in the reordered columns
+    if(factors.order != NULL)
+    {
+        for(int k = 0; k < matrixSize; ++k)
+            imageVector[factors.order[k]] = image[k];
+        delete[] image;
+    }
+}
+
+// DESTROY STRUCTURED:
+//  Deallocates a structured factorization and leaves
+//  it empty.
+void DestroyStructured(StructuredFactorization& factors)
+{
+    if(factors.band.data != NULL)
+        DestroyBandMatrix(factors.band);
+    if(factors.dense.lu.data != NULL)
+        DestroyMatrix(factors.dense.lu);
+
+    delete[] factors.pivots;
+    delete[] factors.order;
+    delete[] factors.rowScales;
+    delete[] factors.dense.pivots;
+    factors.pivots = factors.order = factors.dense.pivots = NULL;
+    factors.rowScales = NULL;
+    factors.size = 0;
+}
+
+// OPEN SYSTEM FILE:
+//  Maps, or failing that reads, a binary system file.
+//  Returns false unless the file holds exactly the
+//  items its header promises.
+bool OpenSystemFile(const char* path, SystemFile& system)
+{
+    system.items = NULL;
+    system.mapping = NULL;
+    system.buffer = NULL;
+
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+        return false;
+
+    char magic[4];
+    uint32_t header[5];
+    bool valid = fread(magic, 1, 4, file) == 4 && memcmp(magic, "LSYS", 4) == 0 &&
+                 fread(header, sizeof(uint32_t), 5, file) == 5 &&
+                 header[0] == SYSTEM_FILE_VERSION && (header[4] == sizeof(float) || header[4] == sizeof(double));
+
+    // The file must hold exactly the items its header promises
+    long bytes = 0;
+    if(valid)
+    {
+        fseek(file, 0, SEEK_END);
+        bytes = ftell(file);
+        size_t items = size_t(header[1])*header[2] + size_t(header[3])*header[1];
+        valid = size_t(bytes) == SYSTEM_FILE_HEADER + items*header[4];
+    }
+    if(!valid)
+    {
+        fclose(file);
+        return false;
+    }
+
+    system.rows = header[1];
+    system.columns = header[2];
+    system.images = header[3];
+    system.itemBytes = header[4];
+
+#ifndef _WIN32
+    void* region = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fileno(file), 0);
+    if(region != MAP_FAILED)
+    {
+        // The items are read once, front to back
+        madvise(region, bytes, MADV_SEQUENTIAL);
+        fclose(file);
+        system.mapping = region;
+        system.bytes = bytes;
+        system.items = static_cast<const char*>(region) + SYSTEM_FILE_HEADER;
+        return true;
+    }
+#endif
+
+    // Without mapping (or where it is unavailable) the items are copied
+    size_t itemBytes = bytes - SYSTEM_FILE_HEADER;
+    system.buffer = new double[(itemBytes + sizeof(double) - 1)/sizeof(double)];
+    fseek(file, SYSTEM_FILE_HEADER, SEEK_SET);
+    bool read = fread(system.buffer, 1, itemBytes, file) == itemBytes;
+    fclose(file);
+    if(!read)
+    {
+        CloseSystemFile(system);
+        return false;
+    }
+
+    system.items = reinterpret_cast<const char*>(system.buffer);
+    return true;
+}
+
+// LOAD ITEMS:
+//  Copies count items of a system file, starting at
+//  item first, converting them to Item.
+template <typename Item>
+void LoadItems(const SystemFile& system, size_t first, int count, Item* items)
+{
+    if(system.itemBytes == sizeof(float))
+    {
+        const float* source = reinterpret_cast<const float*>(system.items) + first;
+        copy(source, source + count, items);
+    }
+    else
+    {
+        const double* source = reinterpret_cast<const double*>(system.items) + first;
+        copy(source, source + count, items);
+    }
+}
+
+// CLOSE SYSTEM FILE:
+//  Unmaps or frees a system file.
+void CloseSystemFile(SystemFile& system)
+{
+#ifndef _WIN32
+    if(system.mapping != NULL)
+        munmap(system.mapping, system.bytes);
+#endif
+    delete[] system.buffer;
+    system.items = NULL;
+    system.mapping = NULL;
+    system.buffer = NULL;
+}
+
+// OPEN BINARY WRITER:
+//  Creates a binary file with the given magic and
+//  sizes, holding items of itemBytes bytes. Returns
+//  false, with no file left open, if the file or its
+//  header could not be written.
+bool OpenBinaryWriter(BinaryWriter& writer, const char* path, const char* magic,
+                      int rows, int columns, int itemBytes)
+{
+    writer.vectors = 0;
+    writer.itemBytes = itemBytes;
+    writer.file = fopen(path, "wb");
+    if(writer.file == NULL)
+        return false;
+
+    uint32_t header[5] = { SYSTEM_FILE_VERSION, uint32_t(rows), uint32_t(columns), 0, uint32_t(itemBytes) };
+    if(fwrite(magic, 1, 4, writer.file) != 4 ||
+       fwrite(header, sizeof(uint32_t), 5, writer.file) != 5)
+    {
+        fclose(writer.file);
+        writer.file = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+// WRITE ITEMS:
+//  Appends count items to a binary file, converting
+//  them to the file's precision.
+template <typename Item>
+bool WriteItems(BinaryWriter& writer, const Item* items, int count)
+{
+    if(sizeof(Item) == size_t(writer.itemBytes))
+        return fwrite(items, sizeof(Item), count, writer.file) == size_t(count);
+
+    // Convert a block of items at a time
+    const int BLOCK = 1024;
+    float singles[BLOCK];
+    double doubles[BLOCK];
+    for(int k = 0; k < count; k += BLOCK)
+    {
+        int block = min(BLOCK, count - k);
+        bool written;
+        if(writer.itemBytes == sizeof(float))
+        {
+            copy(items + k, items + k + block, singles);
+            written = fwrite(singles, sizeof(float), block, writer.file) == size_t(block);
+        }
+        else
+        {
+            copy(items + k, items + k + block, doubles);
+            written = fwrite(doubles, sizeof(double), block, writer.file) == size_t(block);
+        }
+        if(!written)
+            return false;
+    }
+
+    return true;
+}
+
+// CLOSE BINARY WRITER:
+//  Fills in the number of vectors written and closes
+//  the file. Returns false if anything failed to write.
+bool CloseBinaryWriter(BinaryWriter& writer)
+{
+    // The count follows the magic, version, rows and columns
+    uint32_t vectors = writer.vectors;
+    bool written = fseek(writer.file, 16, SEEK_SET) == 0 &&
+                   fwrite(&vectors, sizeof(uint32_t), 1, writer.file) == 1;
+    written = (fclose(writer.file) == 0) && written;
+    writer.file = NULL;
+
+    return written;
+}
+
+// READ TEXT INPUT:
+//  Reads the whole of the standard input.
+void ReadTextInput(TextInput& input)
+{
+    char chunk[1 << 16];
+    size_t bytes;
+    while((bytes = fread(chunk, 1, sizeof(chunk), stdin)) > 0)
+        input.text.insert(input.text.end(), chunk, chunk + bytes);
+
+    input.next = input.text.data();
+    input.end = input.next + input.text.size();
+}
+
+// READ NUMBER:
+//  Parses the next number of the input. Returns false
+//  once the input is used up or is not a number.
+template <typename Number>
+bool ReadNumber(TextInput& input, Number& number)
+{
+    // Skip the spaces, and a plus sign, which from_chars does not accept
+    while(input.next < input.end && isspace(static_cast<unsigned char>(*input.next)))
+        ++input.next;
+    if(input.next < input.end && *input.next == '+')
+        ++input.next;
+
+    from_chars_result result = from_chars(input.next, input.end, number);
+    if(result.ec == errc::result_out_of_range)
+    {
+        // Numbers too small or large for Number are read as
+        // cin would, as zero or the largest Number of their sign
+        double value = strtod(string(input.next, result.ptr).c_str(), NULL);
+        number = (fabs(value) < 1) ? Number(0)
+                 : (value < 0 ? numeric_limits<Number>::lowest() : numeric_limits<Number>::max());
+    }
+    else if(result.ec != errc())
+        return false;
+
+    input.next = result.ptr;
+    return true;
+}
+
+// SOLVE BATCH INPUT:
+//  Reads many systems of one size and solves them as
+//  a batch, printing or writing their preimages. The
+//  input gives the rows, columns and number of systems,
+//  then each system's matrix followed by its image
+//  vector.
+int SolveBatchInput(int threads, const char* solutionPath)
+{
+    TextInput text;
+    ReadTextInput(text);
+
+    int ROWS = 0, COLUMNS = 0, SYSTEMS = 0;
+    ReadNumber(text, ROWS) && ReadNumber(text, COLUMNS) && ReadNumber(text, SYSTEMS);
+
+    if( ROWS != COLUMNS )
+    {
+        cerr << "ERROR: Matrix not invertible. This system only solves square matrices." << endl;
+        return -1;
+    }
+    if(ROWS < 1 || ROWS > MAX_BATCH_SIZE)
+    {
+        cerr << "ERROR: Batches hold systems of 1 to " << MAX_BATCH_SIZE << " rows." << endl;
+        return -1;
+    }
+
+    BatchedSystems batch = CreateBatch(ROWS, SYSTEMS);
+    bool complete = true;
+    for(int s = 0; s < SYSTEMS && complete; ++s)
+    {
+        for(int i = 0; i < ROWS; ++i)
+            for(int j = 0; j < COLUMNS; ++j)
+                complete = ReadNumber(text, batch.Item(s, i, j)) && complete;
+        for(int i = 0; i < ROWS; ++i)
+            complete = ReadNumber(text, batch.Image(s, i)) && complete;
+    }
+    if(!complete)
+    {
+        cerr << "ERROR: Fewer systems were given than promised." << endl;
+        DestroyBatch(batch);
+        return -1;
+    }
+
+    int singular = SolveBatch(batch, threads);
+
+    // Write the preimages to the solution file, or print one per line
+    bool written = true;
+    if(solutionPath != NULL)
+    {
+        BinaryWriter solutions;
+        float* preimage = new float[ROWS];
+        written = OpenBinaryWriter(solutions, solutionPath, "LSOL", ROWS, 0, sizeof(float));
+        for(int s = 0; s < SYSTEMS && written; ++s)
+        {
+            for(int i = 0; i < ROWS; ++i)
+                preimage[i] = batch.Image(s, i);
+            written = WriteItems(solutions, preimage, ROWS);
+            ++solutions.vectors;
+        }
+        written = (solutions.file != NULL) && CloseBinaryWriter(solutions) && written;
+        delete[] preimage;
+
+        if(!written)
+            cerr << "ERROR: Unable to write the solutions to " << solutionPath << endl;
+    }
+    else
+    {
+        cout << "SOLUTION VECTORS:" << '\n';
+        for(int s = 0; s < SYSTEMS; ++s)
+        {
+            for(int i = 0; i < ROWS; ++i)
+                cout << batch.Image(s, i) << (i < ROWS - 1 ? ' ' : '\n');
+        }
+    }
+
+    if(singular > 0)
+        cout << singular << " of the matrices do not have a unique solution." << endl;
+
+    DestroyBatch(batch);
+
+    return written ? 0 : -1;
+}
+
+// CREATE BATCH:
+//  Allocates count systems of the given size, each an
+//  identity matrix with a zero image vector until set.
+//  The unused lanes of the last group are solved along
+//  with the rest, so they must hold a solvable system.
+BatchedSystems CreateBatch(int size, int count)
+{
+    BatchedSystems batch;
+    batch.size = size;
+    batch.count = count;
+    batch.groups = (count + VECTOR_WIDTH - 1)/VECTOR_WIDTH;
+
+    size_t matrixBytes = max<size_t>(size_t(batch.groups)*size*size*sizeof(FloatVector), CACHE_LINE);
+    size_t imageBytes = max<size_t>(size_t(batch.groups)*size*sizeof(FloatVector), CACHE_LINE);
+    batch.matrices = static_cast<FloatVector*>(aligned_alloc(CACHE_LINE, (matrixBytes + CACHE_LINE - 1)/CACHE_LINE*CACHE_LINE));
+    batch.images = static_cast<FloatVector*>(aligned_alloc(CACHE_LINE, (imageBytes + CACHE_LINE - 1)/CACHE_LINE*CACHE_LINE));
+    batch.singular = new bool[count]();
+
+    FloatVector zero = {}, one = zero + 1;
+    for(int g = 0; g < batch.groups; ++g)
+    {
+        FloatVector* matrix = batch.matrices + size_t(g)*size*size;
+        for(int i = 0; i < size; ++i)
+        {
+            for(int j = 0; j < size; ++j)
+                matrix[i*size + j] = (i == j) ? one : zero;
+            batch.images[size_t(g)*size + i] = zero;
+        }
+    }
+
+    return batch;
+}
+
+// DESTROY BATCH:
+//  Deallocates a batch and leaves it empty.
+void DestroyBatch(BatchedSystems& batch)
+{
+    free(batch.matrices);
+    free(batch.images);
+    delete[] batch.singular;
+    batch.matrices = batch.images = NULL;
+    batch.singular = NULL;
+    batch.size = batch.count = batch.groups = 0;
+}
+
+// SOLVE BATCH:
+//  Solves every system of a batch by Gaussian
+//  elimination with scaled partial pivoting, VECTOR_WIDTH
+//  systems at a time, sharing the groups between the
+//  given number of threads. Returns the number of
+//  systems without a unique solution, whose preimages
+//  are left as NaN. Sizes above MAX_BATCH_SIZE are not
+//  solved and return -1.
+int SolveBatch(BatchedSystems& batch, int threads)
+{
+    typedef void (*BatchKernel)(BatchedSystems&, int, int);
+    static const BatchKernel kernels[MAX_BATCH_SIZE + 1] =
+    {
+        NULL,
+        SolveBatchGroups<1>,  SolveBatchGroups<2>,  SolveBatchGroups<3>,  SolveBatchGroups<4>,
+        SolveBatchGroups<5>,  SolveBatchGroups<6>,  SolveBatchGroups<7>,  SolveBatchGroups<8>,
+        SolveBatchGroups<9>,  SolveBatchGroups<10>, SolveBatchGroups<11>, SolveBatchGroups<12>,
+        SolveBatchGroups<13>, SolveBatchGroups<14>, SolveBatchGroups<15>, SolveBatchGroups<16>
+    };
+
+    if(batch.size < 1 || batch.size > MAX_BATCH_SIZE)
+        return -1;
+    BatchKernel kernel = kernels[batch.size];
+
+    // Each thread takes an equal run of groups
+    threads = max(1, min(threads, batch.groups));
+    vector<thread> workers;
+    for(int t = 1; t < threads; ++t)
+        workers.emplace_back(kernel, ref(batch), int(long(batch.groups)*t/threads),
+                             int(long(batch.groups)*(t + 1)/threads));
+    kernel(batch, 0, batch.groups/threads);
+    for(thread& worker : workers)
+        worker.join();
+
+    int singular = 0;
+    for(int s = 0; s < batch.count; ++s)
+        singular += batch.singular[s];
+
+    return singular;
+}
+
+// SOLVE BATCH GROUPS:
+//  Solves the groups [firstGroup, lastGroup) of a batch
+//  of systems of SIZE.
+template <int SIZE>
+void SolveBatchGroups(BatchedSystems& batch, int firstGroup, int lastGroup)
+{
+    for(int g = firstGroup; g < lastGroup; ++g)
+    {
+        IntVector singular = SolveGroup<SIZE>(batch.matrices + size_t(g)*SIZE*SIZE, batch.images + size_t(g)*SIZE);
+
+        for(int lane = 0; lane < VECTOR_WIDTH; ++lane)
+        {
+            int system = g*VECTOR_WIDTH + lane;
+            if(system < batch.count)
+                batch.singular[system] = singular[lane] != 0;
+        }
+    }
+}
+
+// SOLVE GROUP:
+//  Solves VECTOR_WIDTH systems of SIZE at once, one per
+//  lane, each pivoting on its own rows. Returns all bits
+//  set in the lanes without a unique solution. Every
+//  loop has a fixed length, so the compiler unrolls them
+//  and can keep small systems in registers. The rows a
+//  lane swaps are picked by masks rather than branches,
+//  so each lane makes exactly the choices PartialPivot
+//  would for its system alone.
+template <int SIZE>
+IntVector SolveGroup(FloatVector* matrix, FloatVector* image)
+{
+    FloatVector a[SIZE][SIZE], b[SIZE];
+    FloatVector zero = {};
+    IntVector singular = {};
+
+    // Scale each row so its largest item has an absolute value
+    // of 1. A row of zeros leaves its lane singular.
+    #pragma GCC unroll 16
+    for(int i = 0; i < SIZE; ++i)
+    {
+        FloatVector rowMaxAbs = zero;
+        #pragma GCC unroll 16
+        for(int j = 0; j < SIZE; ++j)
+        {
+            a[i][j] = matrix[i*SIZE + j];
+            FloatVector item = (a[i][j] < 0) ? -a[i][j] : a[i][j];
+            rowMaxAbs = (item > rowMaxAbs) ? item : rowMaxAbs;
+        }
+
+        singular |= (rowMaxAbs == 0);
+        rowMaxAbs = (rowMaxAbs == 0) ? zero + 1 : rowMaxAbs;
+
+        #pragma GCC unroll 16
+        for(int j = 0; j < SIZE; ++j)
+            a[i][j] /= rowMaxAbs;
+        b[i] = image[i]/rowMaxAbs;
+    }
+
+    // Eliminate each column in turn
+    #pragma GCC unroll 16
+    for(int k = 0; k < SIZE; ++k)
+    {
+        // Find the first largest item at or below the diagonal
+        FloatVector largest = (a[k][k] < 0) ? -a[k][k] : a[k][k];
+        IntVector pivotRow = IntVector{} + k;
+        #pragma GCC unroll 16
+        for(int r = k + 1; r < SIZE; ++r)
+        {
+            FloatVector item = (a[r][k] < 0) ? -a[r][k] : a[r][k];
+            IntVector larger = (item > largest);
+            largest = larger ? item : largest;
+            pivotRow = larger ? IntVector{} + r : pivotRow;
+        }
+        singular |= (largest == 0);
+
+        // Swap the pivot row up in the lanes that chose it. The
+        // columns left of k are already eliminated.
+        #pragma GCC unroll 16
+        for(int r = k + 1; r < SIZE; ++r)
+        {
+            IntVector take = (pivotRow == r);
+            #pragma GCC unroll 16
+            for(int j = k; j < SIZE; ++j)
+            {
+                FloatVector upper = a[k][j], lower = a[r][j];
+                a[k][j] = take ? lower : upper;
+                a[r][j] = take ? upper : lower;
+            }
+            FloatVector upper = b[k], lower = b[r];
+            b[k] = take ? lower : upper;
+            b[r] = take ? upper : lower;
+        }
+
+        // Subtract multiples of the pivot row from the rows below
+        #pragma GCC unroll 16
+        for(int i = k + 1; i < SIZE; ++i)
+        {
+            FloatVector multiplier = a[i][k]/a[k][k];
+            #pragma GCC unroll 16
+            for(int j = k + 1; j < SIZE; ++j)
+                a[i][j] -= multiplier*a[k][j];
+            b[i] -= multiplier*b[k];
+        }
+    }
+
+    // Back substitute, leaving NaN in the singular lanes
+    FloatVector notANumber = zero + numeric_limits<float>::quiet_NaN();
+    #pragma GCC unroll 16
+    for(int i = SIZE - 1; i >= 0; --i)
+    {
+        FloatVector sum = b[i];
+        #pragma GCC unroll 16
+        for(int j = i + 1; j < SIZE; ++j)
+            sum -= a[i][j]*b[j];
+        b[i] = sum/a[i][i];
+    }
+
+    #pragma GCC unroll 16
+    for(int i = 0; i < SIZE; ++i)
+        image[i] = singular ? notANumber : b[i];
+
+    return singular;
 }